@@ -0,0 +1,40 @@
+/**
+ * \brief Times a map that keeps adding keys and erasing them again with the \c default_value, with the default allocator and with \c extended::node_allocator.
+ * 
+ * \details Usage: \c node_churn \c [keys] \c [rounds]. Each round sets every key and then erases every key, so after the first round a recycling allocator never needs new memory.
+ */
+#include "extended.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+// Runs the churn on one map and gives the time it took in milliseconds.
+template <class Map>
+static double churn(Map& m, int keys, int rounds) {
+	auto start = std::chrono::steady_clock::now();
+	for (int round = 0; round < rounds; ++round) {
+		for (int key = 0; key < keys; ++key) {
+			m << std::make_pair(key * 7919 % keys, (long)round + 1);
+		}
+		for (int key = 0; key < keys; ++key) {
+			m << std::make_pair(key, 0L);
+		}
+	}
+	std::chrono::duration<double, std::milli> took = std::chrono::steady_clock::now() - start;
+	return took.count();
+}
+
+int main(int argc, char** argv) {
+	int keys   = (argc > 1) ? std::atoi(argv[1]) : 10000;
+	int rounds = (argc > 2) ? std::atoi(argv[2]) : 50;
+	
+	extended::map<int, long>         plain(0L);
+	extended::pooled::map<int, long> pooled(0L);
+	double                           plain_ms  = churn(plain, keys, rounds);
+	double                           pooled_ms = churn(pooled, keys, rounds);
+	std::printf("%d keys, %d rounds of set then erase\n", keys, rounds);
+	std::printf("std::allocator:           %.1f ms\n", plain_ms);
+	std::printf("extended::node_allocator: %.1f ms\n", pooled_ms);
+	return (plain.empty() && pooled.empty()) ? 0 : 1;
+}
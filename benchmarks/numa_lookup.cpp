@@ -0,0 +1,96 @@
+/**
+ * \brief Times lookups in an \c extended::concurrent_map from a thread on each NUMA node, split into keys whose shard is on that node and keys whose shard is on another one.
+ * 
+ * \details Usage: \c numa_lookup \c [keys] \c [rounds]. On a machine with one node every key is local and only that line is printed.
+ */
+#include "extended.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+// Finds the first CPU of a node from its sysfs cpulist, or -1 if it cannot be told.
+static int first_cpu(int node) {
+#if defined(__linux__)
+	std::ifstream list("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+	int           cpu = -1;
+	if (list >> cpu) {
+		return cpu;
+	}
+#else
+	(void)node;
+#endif
+	return -1;
+}
+
+// Pins the calling thread to one CPU.
+static void pin(int cpu) {
+#if defined(__linux__)
+	if (cpu >= 0) {
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		CPU_SET(cpu, &set);
+		pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+	}
+#else
+	(void)cpu;
+#endif
+}
+
+// Looks up every key a number of times and gives the average time of one lookup in nanoseconds.
+static double time_lookups(const extended::concurrent_map<uint64_t, uint64_t>& m, const std::vector<uint64_t>& keys, int rounds) {
+	if (keys.empty()) {
+		return 0.0;
+	}
+	volatile uint64_t sink  = 0;
+	auto              start = std::chrono::steady_clock::now();
+	for (int round = 0; round < rounds; ++round) {
+		for (uint64_t key : keys) {
+			sink = sink + (m >> key);
+		}
+	}
+	std::chrono::duration<double, std::nano> took = std::chrono::steady_clock::now() - start;
+	return took.count() / ((double)keys.size() * rounds);
+}
+
+int main(int argc, char** argv) {
+	std::size_t count  = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+	int         rounds = (argc > 2) ? std::atoi(argv[2]) : 5;
+	int         nodes  = extended::numa::nodes();
+	
+	extended::concurrent_map<uint64_t, uint64_t> m(0, 8 * (std::size_t)nodes);
+	for (uint64_t key = 1; key <= count; ++key) {
+		m << std::make_pair(key * 2654435761u, key);
+	}
+	std::printf("%d node(s), %zu keys, %zu shards\n", nodes, count, m.shard_count());
+	
+	for (int node = 0; node < nodes; ++node) {
+		std::thread reader([&, node] {
+			pin(first_cpu(node));
+			std::vector<uint64_t> local;
+			std::vector<uint64_t> remote;
+			for (uint64_t key = 1; key <= count; ++key) {
+				uint64_t spread = key * 2654435761u;
+				int      home   = m.node_of(spread); // -1 when the map is not placed on nodes, every key is then local
+				((home < 0) || (home == node) ? local : remote).push_back(spread);
+			}
+			double near = time_lookups(m, local, rounds);
+			double far  = time_lookups(m, remote, rounds);
+			if (remote.empty()) {
+				std::printf("node %d: local %.1f ns/lookup (%zu keys)\n", node, near, local.size());
+			} else {
+				std::printf("node %d: local %.1f ns/lookup (%zu keys), remote %.1f ns/lookup (%zu keys)\n", node, near, local.size(), far, remote.size());
+			}
+		});
+		reader.join();
+	}
+	return 0;
+}
@@ -23,10 +23,50 @@
 #define __EXTENDED_H__
 
 #include <map>
+#include <memory_resource>
+#include <set>
 #include <iterator>
 #include <string>
+#include <string_view>
+#include <deque>
+#include <unordered_map>
 #include <utility>
 #include <type_traits>
+#include <vector>
+#include <algorithm>
+#include <thread>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <atomic>
+#include <cstring>
+#include <chrono>
+#include <tuple>
+#include <new>
+#include <cstdlib>
+#include <condition_variable>
+#include <future>
+#include <optional>
+#include <exception>
+#include "pool.h"
+#ifdef EXTENDED_NUMA
+#include <numa.h>
+#include <sched.h>
+#endif
+#if defined(__linux__)
+#include <fstream>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#if __cplusplus >= 202002L
+#include <span>
+#endif
+#if (__cplusplus >= 202002L) && defined(__cpp_impl_coroutine)
+#include <coroutine>
+#endif
 
 namespace extended {
 	/**
@@ -94,6 +134,217 @@ namespace extended {
 	
 	template <class A>
 	const A null<A&, false>::value = nullptr;
+	/**@}
+	 * \defgroup filter extended::filter
+	 * 
+	 * \brief The optional key filter in front of \c extended::map lookups.
+	 * 
+	 * \details A blocked Bloom filter that remembers which keys may be in a map, so that most lookups of keys that are not in the map can return the \c default_value without searching the map.
+	 * @{
+	 */
+	
+	/**
+	 * \brief \c hashable\<A\> is \c true if \c std::hash\<A\> can be used, only those key types can use a \ref filter "extended::filter".
+	 */
+	template <class A, class = void>
+	struct hashable : std::false_type {};
+	
+	template <class A>
+	struct hashable<A, std::void_t<decltype(std::hash<A>()(std::declval<const A&>()))>> : std::true_type {};
+	
+	/**
+	 * \brief \c filter_stats counts how often the filter answered a lookup.
+	 */
+	struct filter_stats {
+		uint64_t lookups         = 0; ///< \c lookups is the number of lookups that checked the filter.
+		uint64_t skipped         = 0; ///< \c skipped is the number of lookups the filter answered without searching the map.
+		uint64_t false_positives = 0; ///< \c false_positives is the number of lookups the filter passed to the map that were not in it.
+		
+		/**
+		 * \brief This is the share of missing keys that the filter did not catch.
+		 * 
+		 * \return Returns \c false_positives divided by all lookups of missing keys, or \c 0 if there were none.
+		 */
+		double false_positive_rate() const {
+			uint64_t misses = skipped + false_positives;
+			return (misses > 0) ? (double)false_positives / (double)misses : 0.0;
+		}
+	};
+	
+	/**
+	 * \brief \c filter_counters is where a map counts its filter answers, lookups only ever add to it with relaxed atomics so that sharing a map between readers stays safe.
+	 */
+	struct filter_counters {
+		std::atomic<uint64_t> lookups{0};         ///< \c lookups is the number of lookups that checked the filter.
+		std::atomic<uint64_t> skipped{0};         ///< \c skipped is the number of lookups the filter answered without searching the map.
+		std::atomic<uint64_t> false_positives{0}; ///< \c false_positives is the number of lookups the filter passed to the map that were not in it.
+		
+		filter_counters() = default;
+		filter_counters(const filter_counters& other) { (*this) = other; }
+		
+		/**
+		 * \brief This copies the counts of another map.
+		 * 
+		 * \param [in] other is the counts to copy.
+		 * \return Returns \c *this.
+		 */
+		filter_counters& operator= (const filter_counters& other) {
+			lookups.store(other.lookups.load(std::memory_order_relaxed), std::memory_order_relaxed);
+			skipped.store(other.skipped.load(std::memory_order_relaxed), std::memory_order_relaxed);
+			false_positives.store(other.false_positives.load(std::memory_order_relaxed), std::memory_order_relaxed);
+			return *this;
+		}
+		
+		/**
+		 * \brief This sets every count back to zero.
+		 * 
+		 * \return Returns \c void.
+		 */
+		void reset() {
+			lookups.store(0, std::memory_order_relaxed);
+			skipped.store(0, std::memory_order_relaxed);
+			false_positives.store(0, std::memory_order_relaxed);
+		}
+		
+		/**
+		 * \brief This reads the counts.
+		 * 
+		 * \return Returns the counts as a \c filter_stats .
+		 */
+		filter_stats load() const {
+			filter_stats out;
+			out.lookups         = lookups.load(std::memory_order_relaxed);
+			out.skipped         = skipped.load(std::memory_order_relaxed);
+			out.false_positives = false_positives.load(std::memory_order_relaxed);
+			return out;
+		}
+	};
+	
+	/**
+	 * \brief The blocked Bloom filter used by \c extended::map.
+	 * 
+	 * \details Each key sets a few bits inside one 64 byte block, so a lookup touches a single cache line. Keys cannot be taken out of the filter, keys that were erased are only forgotten when the filter is rebuilt, which the map does during \c operator! .
+	 */
+	template <class A>
+	class filter {
+		protected:
+			std::vector<uint64_t> bits;      ///< \c bits is the filter, in blocks of 8 words.
+			std::size_t           items = 0; ///< \c items is the number of keys added since the last reset.
+			std::size_t           limit = 0; ///< \c limit is the number of keys the filter was sized for.
+			
+			static uint64_t mix(uint64_t);
+		public:
+			void reset(std::size_t);
+			void clear();
+			void insert(const A&);
+			bool contains(const A&) const;
+			bool enabled() const;
+			bool full() const;
+	};
+	
+	/**
+	 * \brief This scrambles a hash so that every bit depends on every input bit.
+	 * 
+	 * \param [in] h is the hash.
+	 * \return Returns the scrambled hash.
+	 */
+	template <class A>
+	uint64_t filter<A>::mix(uint64_t h) {
+		h ^= h >> 33;
+		h *= 0xff51afd7ed558ccdULL;
+		h ^= h >> 33;
+		h *= 0xc4ceb9fe1a85ec53ULL;
+		h ^= h >> 33;
+		return h;
+	}
+	
+	/**
+	 * \brief This empties the filter and sizes it for a number of keys.
+	 * 
+	 * \param [in] expected is the number of keys the filter should hold, it will use about 16 bits per key.
+	 * \return Returns \c void.
+	 */
+	template <class A>
+	void filter<A>::reset(std::size_t expected) {
+		if (expected < 64) {
+			expected = 64;
+		}
+		bits.assign(((expected * 16 + 511) / 512) * 8, 0);
+		items = 0;
+		limit = expected;
+	}
+	
+	/**
+	 * \brief This turns the filter off and frees its memory.
+	 * 
+	 * \return Returns \c void.
+	 */
+	template <class A>
+	void filter<A>::clear() {
+		bits  = std::vector<uint64_t>();
+		items = 0;
+		limit = 0;
+	}
+	
+	/**
+	 * \brief This adds a key to the filter.
+	 * 
+	 * \param [in] key is the key to add.
+	 * \return Returns \c void.
+	 */
+	template <class A>
+	void filter<A>::insert(const A& key) {
+		if constexpr (hashable<A>::value) {
+			uint64_t  h     = mix(std::hash<A>()(key));
+			uint64_t* block = bits.data() + (h % (bits.size() / 8)) * 8;
+			for (int i = 0; i < 6; i++) {
+				h = (h >> 9) | (h << 55);
+				block[(h >> 6) & 7] |= 1ULL << (h & 63);
+			}
+			items++;
+		}
+	}
+	
+	/**
+	 * \brief This checks if a key may have been added to the filter.
+	 * 
+	 * \param [in] key is the key to look for.
+	 * \return Returns \c false only if the key was never added since the last reset.
+	 */
+	template <class A>
+	bool filter<A>::contains(const A& key) const {
+		if constexpr (hashable<A>::value) {
+			uint64_t        h     = mix(std::hash<A>()(key));
+			const uint64_t* block = bits.data() + (h % (bits.size() / 8)) * 8;
+			for (int i = 0; i < 6; i++) {
+				h = (h >> 9) | (h << 55);
+				if ((block[(h >> 6) & 7] & (1ULL << (h & 63))) == 0) {
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+	
+	/**
+	 * \brief This checks if the filter is in use.
+	 * 
+	 * \return Returns \c true if the filter has been sized by \c reset.
+	 */
+	template <class A>
+	bool filter<A>::enabled() const {
+		return !bits.empty();
+	}
+	
+	/**
+	 * \brief This checks if the filter holds more keys than it was sized for.
+	 * 
+	 * \return Returns \c true if the filter should be rebuilt larger.
+	 */
+	template <class A>
+	bool filter<A>::full() const {
+		return items > limit;
+	}
 	/**@}
 	 * \defgroup map extended::map
 	 * 
@@ -105,247 +356,6575 @@ namespace extended {
 	 * @{
 	 */
 	/**
-	 * \brief The memory saving version of \c std::map<A, B>.
+	 * \brief \c bulk selects how a range is loaded by the bulk constructors.
+	 * 
+	 * \details \c sorted tells the constructor that the range is already in key order so that it can skip the sort, \c parallel lets the sort and the building of the map be split across threads for large inputs.
+	 */
+	struct bulk {
+		bool        sorted   = false; ///< \c sorted is \c true if the range is already in key order.
+		bool        parallel = false; ///< \c parallel is \c true if the sort and build may be split across threads.
+		std::size_t threads  = 0;     ///< \c threads is the most threads to use when \c parallel is \c true, \c 0 uses one per thread of the shared \c extended::pool and one for the calling thread.
+	};
+	
+	/**
+	 * \brief This splits a count of items into even ranges and runs a function on each range on the shared \c extended::pool.
+	 * 
+	 * \param [in] count is the number of items.
+	 * \param [in] threads is the number of ranges, \c 0 uses one per thread of the pool and one for the calling thread, it is lowered so no range is empty.
+	 * \param [in] f is called as \c f(range, begin, end) for each range.
+	 * \return Returns the number of ranges that were used.
+	 * 
+	 * \details The ranges are shared out by work stealing, so asking for more ranges than threads evens out ranges that take longer. The calling thread works on the ranges too, and this only returns once every range is done.
+	 */
+	template <class F>
+	std::size_t parallel_for(std::size_t count, std::size_t threads, F f) {
+		if (threads == 0) {
+			threads = pool::shared().size() + 1;
+		}
+		threads = std::max<std::size_t>(std::min(threads, count), 1);
+		if (threads == 1) {
+			f(0, 0, count);
+			return 1;
+		}
+		pool::shared().run(threads, [&](std::size_t t) {
+			f(t, count * t / threads, count * (t + 1) / threads);
+		});
+		return threads;
+	}
+	
+	/**
+	 * \brief This stable sorts a list of pairs by key, optionally splitting the work across threads.
+	 * 
+	 * \param [in,out] items is the list of pairs to be sorted.
+	 * \param [in] comp is the key comparison of the map the pairs are for.
+	 * \param [in] threads is the most threads to use, \c 0 uses one per thread of the shared \c extended::pool and one for the calling thread.
+	 * \return Returns \c void.
+	 * 
+	 * \details The parallel sort stable sorts one run per thread and then merges the runs pairwise, it is only used when the list is large enough to be worth starting the threads.
+	 */
+	template <class A, class B, class Compare>
+	void sort_pairs(std::vector<std::pair<A, B>>& items, Compare comp, std::size_t threads) {
+		auto less = [&comp](const std::pair<A, B>& x, const std::pair<A, B>& y) { return comp(x.first, y.first); };
+		if ((threads == 1) || (items.size() < (1u << 16))) {
+			std::stable_sort(items.begin(), items.end(), less);
+			return;
+		}
+		std::vector<std::size_t> bounds;
+		std::size_t runs = parallel_for(items.size(), threads, [&items, &less](std::size_t, std::size_t begin, std::size_t end) {
+			std::stable_sort(items.begin() + begin, items.begin() + end, less);
+		});
+		for (std::size_t t = 0; t <= runs; t++) {
+			bounds.push_back(items.size() * t / runs);
+		}
+		while (bounds.size() > 2) {
+			std::vector<std::size_t> merged;
+			for (std::size_t i = 0; i + 2 < bounds.size(); i += 2) {
+				std::inplace_merge(items.begin() + bounds[i], items.begin() + bounds[i + 1], items.begin() + bounds[i + 2], less);
+				merged.push_back(bounds[i]);
+			}
+			if (bounds.size() % 2 == 0) {
+				merged.push_back(bounds[bounds.size() - 2]);
+			}
+			merged.push_back(bounds.back());
+			bounds.swap(merged);
+		}
+	}
+	
+	/**
+	 * \brief This moves a map position forward to the first entry that is not less than a key.
+	 * 
+	 * \param [in] in is the map being walked.
+	 * \param [in] pos is the current position, no entry before it may be needed again.
+	 * \param [in] key is the key to move to.
+	 * \return Returns the first position at or after \c pos whose key is not less than \c key.
+	 * 
+	 * \details Nearby keys are reached by stepping forward, which stays in the part of the tree that was just used, the map is only searched again when the key is further away.
+	 */
+	template <class Map, class Iterator, class A>
+	Iterator seek_forward(Map& in, Iterator pos, const A& key) {
+		auto comp = in.key_comp();
+		for (int steps = 0; (pos != in.end()) && comp((*pos).first, key); steps++) {
+			if (steps == 8) {
+				return in.lower_bound(key);
+			}
+			std::advance(pos, 1);
+		}
+		return pos;
+	}
+	
+	/**
+	 * \brief This merges a list of pairs sorted by key into a \c std::map in one ordered pass.
+	 * 
+	 * \param [in,out] out is the map to be updated.
+	 * \param [in] items is the list of pairs, sorted by key.
+	 * \param [in] is_default is \c true for values that are not to be saved.
+	 * \return Returns \c void.
+	 * 
+	 * \details When a key is repeated the last pair wins. A default value erases the key, any other value is saved. The position in the map only moves forward, it is stepped for nearby keys and only searched for again when the next key is further away, and every insert is hinted, so an empty map is filled in linear time.
+	 */
+	template <class Map, class Iterator, class IsDefault>
+	void merge_sorted(Map& out, Iterator first, Iterator last, IsDefault is_default) {
+		auto comp = out.key_comp();
+		auto pos  = out.begin();
+		for (Iterator it = first; it != last; std::advance(it, 1)) {
+			if ((std::next(it) != last) && !comp((*it).first, (*std::next(it)).first)) {
+				continue;
+			}
+			pos = seek_forward(out, pos, (*it).first);
+			if ((pos != out.end()) && !comp((*it).first, (*pos).first)) {
+				if (is_default((*it).second)) {
+					pos = out.erase(pos);
+				} else {
+					(*pos).second = std::move((*it).second);
+				}
+			} else if (!is_default((*it).second)) {
+				out.emplace_hint(pos, std::move((*it).first), std::move((*it).second));
+			}
+		}
+	}
+	
+	/**
+	 * \brief This moves the entries of one map into another in one ordered pass, relinking their nodes instead of copying them.
+	 * 
+	 * \param [in,out] out is the map to be updated.
+	 * \param [in,out] items is the map of updates, it must use an allocator equal to that of \c out and is left empty.
+	 * \param [in] is_default is \c true for values that are not to be saved.
+	 * \return Returns \c void.
+	 * 
+	 * \details A default value erases the key, any other value replaces the node of the key or is linked in as a new one. The position in \c out moves forward like in \c merge_sorted. Nothing is allocated or copied, so as long as comparing keys and values does not throw, the pass either applies every update or never starts.
+	 */
+	template <class Map, class Items, class IsDefault>
+	void splice_sorted(Map& out, Items& items, IsDefault is_default) {
+		auto comp = out.key_comp();
+		auto pos  = out.begin();
+		while (!items.empty()) {
+			auto node = items.extract(items.begin());
+			pos = seek_forward(out, pos, node.key());
+			if ((pos != out.end()) && !comp(node.key(), (*pos).first)) {
+				pos = out.erase(pos);
+			}
+			if (!is_default(node.mapped())) {
+				pos = std::next(out.insert(pos, std::move(node)));
+			}
+		}
+	}
+	
+	/**
+	 * \brief This fills an empty map from a list of pairs sorted by key, building parts of it on separate threads.
+	 * 
+	 * \param [out] out is the empty map to be filled.
+	 * \param [in] items is the list of pairs, sorted by key.
+	 * \param [in] is_default is \c true for values that are not to be saved.
+	 * \param [in] threads is the most threads to use, \c 0 uses one per thread of the shared \c extended::pool and one for the calling thread.
+	 * \return Returns \c void.
+	 * 
+	 * \details The list is cut into ranges that never split a repeated key, each thread builds a map of its range with \c merge_sorted, which is where the entries are allocated and copied, and then the entries are moved into \c out in order with \c extract, so joining the parts only relinks nodes.
+	 * \note Only allocators whose copies are all equal, such as \c std::allocator and \c extended::node_allocator, build in parallel. A stateful allocator such as a \c std::pmr::polymorphic_allocator or an \c extended::arena_allocator usually has a resource that is not safe to use from several threads, so the map is built on the calling thread.
+	 */
+	template <class Map, class A, class B, class IsDefault>
+	void build_parallel(Map& out, std::vector<std::pair<A, B>>& items, IsDefault is_default, std::size_t threads) {
+		using part = std::map<typename Map::key_type, typename Map::mapped_type, typename Map::key_compare, typename Map::allocator_type>;
+		auto comp = out.key_comp();
+		if ((threads == 1) || (items.size() < (1u << 16)) || !std::allocator_traits<typename Map::allocator_type>::is_always_equal::value) {
+			merge_sorted(out, items.begin(), items.end(), is_default);
+			return;
+		}
+		if (threads == 0) {
+			threads = pool::shared().size() + 1;
+		}
+		std::vector<part> parts;
+		parts.reserve(threads);
+		for (std::size_t t = 0; t < threads; t++) {
+			parts.emplace_back(comp, out.get_allocator());
+		}
+		parallel_for(threads, threads, [&](std::size_t t, std::size_t, std::size_t) {
+			std::size_t begin = items.size() * t / threads;
+			std::size_t end   = items.size() * (t + 1) / threads;
+			while ((begin > 0) && (begin < items.size()) && !comp(items[begin - 1].first, items[begin].first)) {
+				begin++;
+			}
+			while ((end > 0) && (end < items.size()) && !comp(items[end - 1].first, items[end].first)) {
+				end++;
+			}
+			if (begin < end) {
+				merge_sorted(parts[t], items.begin() + begin, items.begin() + end, is_default);
+			}
+		});
+		for (auto& built : parts) {
+			while (!built.empty()) {
+				out.insert(out.end(), built.extract(built.begin()));
+			}
+		}
+	}
+	
+	/**
+	 * \brief This cuts a map into even ranges of entries.
+	 * 
+	 * \param [in] in is the map.
+	 * \param [in] parts is the number of ranges, \c 0 uses four per thread of the shared \c extended::pool so that work stealing can even out ranges that take longer.
+	 * \return Returns the start of each range followed by \c in.end(), there are never more ranges than entries.
+	 * 
+	 * \details The map is walked once to find the starts.
+	 */
+	template <class Map>
+	std::vector<typename Map::iterator> split_ranges(Map& in, std::size_t parts) {
+		if (parts == 0) {
+			parts = 4 * (pool::shared().size() + 1);
+		}
+		parts = std::max<std::size_t>(std::min(parts, in.size()), 1);
+		std::vector<typename Map::iterator> starts;
+		std::size_t index = 0;
+		for (auto it = in.begin(); (it != in.end()) && (starts.size() < parts); std::advance(it, 1), index++) {
+			if (index == in.size() * starts.size() / parts) {
+				starts.push_back(it);
+			}
+		}
+		if (starts.empty()) {
+			starts.push_back(in.end());
+		}
+		starts.push_back(in.end());
+		return starts;
+	}
+	
+	/**
+	 * \brief This erases every entry whose value is a default value, optionally scanning parts of the map on separate threads.
+	 * 
+	 * \param [in,out] out is the map to compact.
+	 * \param [in] is_default is \c true for values that are not to be saved.
+	 * \param [in] threads is the most threads to use, \c 0 uses one per thread of the shared \c extended::pool and one for the calling thread.
+	 * \return Returns \c void.
+	 * 
+	 * \details The parallel version walks the map once to cut it into even key ranges, each thread checks the values in its range, and then the entries that were found are erased on the calling thread, since a \c std::map cannot be changed by several threads at once. It is only used when the map is large enough to be worth starting the threads.
+	 */
+	template <class Map, class IsDefault>
+	void compact_map(Map& out, IsDefault is_default, std::size_t threads) {
+		if ((threads == 1) || (out.size() < (1u << 16))) {
+			for (auto it = out.begin(); it != out.end(); ) {
+				if (is_default((*it).second)) {
+					it = out.erase(it);
+				} else {
+					std::advance(it, 1);
+				}
+			}
+			return;
+		}
+		auto starts = split_ranges(out, threads);
+		threads     = starts.size() - 1;
+		std::vector<std::vector<typename Map::iterator>> found(threads);
+		parallel_for(threads, threads, [&](std::size_t t, std::size_t, std::size_t) {
+			for (auto it = starts[t]; it != starts[t + 1]; std::advance(it, 1)) {
+				if (is_default((*it).second)) {
+					found[t].push_back(it);
+				}
+			}
+		});
+		for (auto& list : found) {
+			for (auto it : list) {
+				out.erase(it);
+			}
+		}
+	}
+	
+	/**
+	 * \brief \c execution picks how the map algorithms run.
+	 */
+	enum class execution {
+		sequential, ///< \c sequential runs on the calling thread in key order.
+		parallel    ///< \c parallel splits the map into even key ranges that run on separate threads.
+	};
+	
+	/**
+	 * \brief This calls a function on every entry of a map.
+	 * 
+	 * \param [in] in is the map.
+	 * \param [in] how is how the calls are run.
+	 * \param [in] f is called as \c f(key, value), it must be safe to call from several threads at once for \c execution::parallel .
+	 * \return Returns \c void.
+	 */
+	template <class Map, class F>
+	void map_for_each(Map& in, execution how, F f) {
+		if ((how != execution::parallel) || (in.size() < (1u << 14))) {
+			for (auto it = in.begin(); it != in.end(); std::advance(it, 1)) {
+				f((*it).first, (*it).second);
+			}
+			return;
+		}
+		auto starts = split_ranges(in, 0);
+		parallel_for(starts.size() - 1, starts.size() - 1, [&](std::size_t t, std::size_t, std::size_t) {
+			for (auto it = starts[t]; it != starts[t + 1]; std::advance(it, 1)) {
+				f((*it).first, (*it).second);
+			}
+		});
+	}
+	
+	/**
+	 * \brief This replaces every value of a map with a function of its entry, erasing entries whose new value is a default value.
+	 * 
+	 * \param [in,out] out is the map.
+	 * \param [in] how is how the calls are run.
+	 * \param [in] f is called as \c f(key, value) and returns the new value, it must be safe to call from several threads at once for \c execution::parallel .
+	 * \param [in] is_default is \c true for values that are not to be saved.
+	 * \return Returns \c void.
+	 * 
+	 * \details New values are written in place, the entries to erase are collected and erased on the calling thread afterwards.
+	 */
+	template <class Map, class F, class IsDefault>
+	void map_transform(Map& out, execution how, F f, IsDefault is_default) {
+		std::vector<typename Map::iterator> found;
+		if ((how == execution::sequential) || (out.size() < (1u << 14))) {
+			for (auto it = out.begin(); it != out.end(); std::advance(it, 1)) {
+				(*it).second = f((*it).first, (*it).second);
+				if (is_default((*it).second)) {
+					found.push_back(it);
+				}
+			}
+		} else {
+			auto starts = split_ranges(out, 0);
+			std::vector<std::vector<typename Map::iterator>> lists(starts.size() - 1);
+			parallel_for(lists.size(), lists.size(), [&](std::size_t t, std::size_t, std::size_t) {
+				for (auto it = starts[t]; it != starts[t + 1]; std::advance(it, 1)) {
+					(*it).second = f((*it).first, (*it).second);
+					if (is_default((*it).second)) {
+						lists[t].push_back(it);
+					}
+				}
+			});
+			for (auto& list : lists) {
+				found.insert(found.end(), list.begin(), list.end());
+			}
+		}
+		for (auto it : found) {
+			out.erase(it);
+		}
+	}
+	
+	/**
+	 * \brief This combines a function of every entry of a map into one result.
+	 * 
+	 * \param [in] in is the map.
+	 * \param [in] how is how the calls are run.
+	 * \param [in] init is the starting result.
+	 * \param [in] f is called as \c f(key, value) and returns what that entry adds to the result.
+	 * \param [in] combine is called as \c combine(result, part) and returns the combined result, it must be associative for \c execution::parallel .
+	 * \return Returns the result.
+	 * 
+	 * \details For \c execution::parallel each range is combined on its own thread, then the range results are combined into \c init in key order.
+	 */
+	template <class Map, class T, class F, class Combine>
+	T map_reduce(const Map& in, execution how, T init, F f, Combine combine) {
+		if ((how == execution::sequential) || (in.size() < (1u << 14))) {
+			for (auto it = in.begin(); it != in.end(); std::advance(it, 1)) {
+				init = combine(std::move(init), f((*it).first, (*it).second));
+			}
+			return init;
+		}
+		auto starts = split_ranges(const_cast<Map&>(in), 0);
+		std::vector<std::pair<bool, T>> results(starts.size() - 1, std::pair<bool, T>(false, init));
+		parallel_for(results.size(), results.size(), [&](std::size_t t, std::size_t, std::size_t) {
+			for (auto it = starts[t]; it != starts[t + 1]; std::advance(it, 1)) {
+				if (results[t].first) {
+					results[t].second = combine(std::move(results[t].second), f((*it).first, (*it).second));
+				} else {
+					results[t] = std::pair<bool, T>(true, f((*it).first, (*it).second));
+				}
+			}
+		});
+		for (auto& result : results) {
+			if (result.first) {
+				init = combine(std::move(init), std::move(result.second));
+			}
+		}
+		return init;
+	}
+	
+	/**
+	 * \brief This looks up a list of keys in a map, writing the default value for keys that are missing.
+	 * 
+	 * \param [in] in is the map to read from.
+	 * \param [in] first is the start of the keys to look up.
+	 * \param [in] last is the end of the keys to look up.
+	 * \param [out] out is the start of where the values are written, one for each key.
+	 * \param [in] default_value is the value written for missing keys.
+	 * \return Returns \c void.
+	 * 
+	 * \details Sorted keys are answered with a merge join, walking the map forward once. Large unsorted lists are visited in key order through a sorted list of their positions, so the lookups still share one forward walk instead of each one starting at the root. Small unsorted lists are looked up one at a time.
+	 */
+	template <class Map, class KeyIt, class OutIt, class B>
+	void lookup_many(const Map& in, KeyIt first, KeyIt last, OutIt out, const B& default_value) {
+		auto comp   = in.key_comp();
+		auto count  = static_cast<std::size_t>(std::distance(first, last));
+		auto pos    = in.begin();
+		bool sorted = std::is_sorted(first, last, comp);
+		if (sorted) {
+			for (std::size_t i = 0; i < count; i++) {
+				pos = seek_forward(in, pos, first[i]);
+				out[i] = ((pos != in.end()) && !comp(first[i], (*pos).first)) ? (*pos).second : default_value;
+			}
+			return;
+		}
+		if (count < 64) {
+			for (std::size_t i = 0; i < count; i++) {
+				auto it = in.find(first[i]);
+				out[i] = (it != in.end()) ? (*it).second : default_value;
+			}
+			return;
+		}
+		std::vector<std::size_t> order(count);
+		for (std::size_t i = 0; i < count; i++) {
+			order[i] = i;
+		}
+		std::sort(order.begin(), order.end(), [&](std::size_t x, std::size_t y) { return comp(first[x], first[y]); });
+		for (std::size_t i : order) {
+			pos = seek_forward(in, pos, first[i]);
+			out[i] = ((pos != in.end()) && !comp(first[i], (*pos).first)) ? (*pos).second : default_value;
+		}
+	}
+	
+	/**
+	 * \brief \c layout_stats describes how the nodes of a map are laid out in memory.
+	 */
+	struct layout_stats {
+		std::size_t entries    = 0; ///< \c entries is the number of entries.
+		std::size_t node_bytes = 0; ///< \c node_bytes is about how much memory the nodes take, counting the tree links of each node.
+		std::size_t span_bytes = 0; ///< \c span_bytes is the distance from the lowest node to the end of the highest one.
+		std::size_t page_jumps = 0; ///< \c page_jumps is the number of entries whose node is on another 4 KB page from the node of the entry before it in key order.
+		
+		/**
+		 * \brief This is how often an in order scan moves to another page.
+		 * 
+		 * \return Returns \c page_jumps divided by the number of steps of a scan, or \c 0 if there are fewer than two entries.
+		 */
+		double fragmentation() const {
+			return (entries > 1) ? (double)page_jumps / (double)(entries - 1) : 0.0;
+		}
+	};
+	
+	/**
+	 * \brief This measures how the nodes of a map are laid out in memory.
+	 * 
+	 * \param [in] in is the map.
+	 * \return Returns the layout.
+	 * 
+	 * \details The position of each entry stands in for its node, the tree links sit just before it.
+	 */
+	template <class Map>
+	layout_stats measure_layout(const Map& in) {
+		const std::size_t node = sizeof(typename Map::value_type) + 4 * sizeof(void*);
+		layout_stats out;
+		uintptr_t    low  = UINTPTR_MAX;
+		uintptr_t    high = 0;
+		uintptr_t    last = 0;
+		for (auto it = in.begin(); it != in.end(); std::advance(it, 1)) {
+			uintptr_t here = (uintptr_t)&(*it);
+			if ((out.entries > 0) && ((here >> 12) != (last >> 12))) {
+				out.page_jumps++;
+			}
+			low  = std::min(low, here);
+			high = std::max(high, here);
+			last = here;
+			out.entries++;
+		}
+		out.node_bytes = out.entries * node;
+		out.span_bytes = (out.entries > 0) ? (std::size_t)(high - low) + node : 0;
+		return out;
+	}
+	
+	/**
+	 * \brief This copies every entry of a map into new nodes made one after another in key order, then frees the old nodes.
+	 * 
+	 * \param [in,out] out is the map.
+	 * \param [in] is_default is \c true for values that are not to be saved.
+	 * \param [in] compact is \c true to leave out values that are default values while copying.
+	 * \return Returns \c void.
+	 * 
+	 * \details Every new node is made before any old node is freed, so the allocator cannot hand back the scattered old nodes and the new ones come from fresh memory in the order a scan reads them. The values are copied rather than moved so that memory they own is laid out again too. For a short while the map takes twice its memory.
+	 * \note The allocator may still hand out holes left by earlier frees, so if the new nodes are no less scattered than the old ones and nothing was dropped, the old nodes are kept and the copies freed instead. The layout is never made worse.
+	 */
+	template <class Map, class IsDefault>
+	void relayout_map(Map& out, IsDefault is_default, bool compact) {
+		std::map<typename Map::key_type, typename Map::mapped_type, typename Map::key_compare, typename Map::allocator_type> fresh(out.key_comp(), out.get_allocator());
+		for (auto it = out.begin(); it != out.end(); std::advance(it, 1)) {
+			if (!compact || !is_default((*it).second)) {
+				fresh.emplace_hint(fresh.end(), (*it).first, (*it).second);
+			}
+		}
+		if ((fresh.size() == out.size()) && (measure_layout(fresh).page_jumps >= measure_layout(out).page_jumps)) {
+			return;
+		}
+		static_cast<decltype(fresh)&>(out).swap(fresh);
+	}
+	
+#if (__cplusplus >= 202002L) && defined(__cpp_impl_coroutine)
+	/**
+	 * \brief \c pacing sets how often a long asynchronous map operation gives control back to an event loop.
+	 * 
+	 * \details After every \c items entries the operation suspends and hands itself to \c post, which should queue it on the event loop to be resumed later. If \c post is empty the operation runs to the end without suspending.
+	 */
+	struct pacing {
+		std::size_t                                   items = 1024; ///< \c items is how many entries are handled between suspensions.
+		std::function<void(std::coroutine_handle<>)> post;          ///< \c post queues a suspended operation to be resumed, it may be empty.
+	};
+	
+	/**
+	 * \brief The awaitable that suspends an operation and hands it to \c pacing::post.
+	 */
+	struct pace {
+		const pacing& how; ///< \c how is the pacing of the operation.
+		
+		/**
+		 * \brief This checks whether the operation should keep running instead.
+		 * 
+		 * \return Returns \c true if there is no \c post to hand the operation to.
+		 */
+		bool await_ready() const noexcept {
+			return !how.post;
+		}
+		
+		/**
+		 * \brief This hands the suspended operation to \c post.
+		 * 
+		 * \param [in] self is the operation.
+		 * \return Returns \c void.
+		 */
+		void await_suspend(std::coroutine_handle<> self) const {
+			how.post(self);
+		}
+		
+		/**
+		 * \brief This is called when the operation is resumed.
+		 * 
+		 * \return Returns \c void.
+		 */
+		void await_resume() const noexcept {}
+	};
+	
+	/**
+	 * \brief The coroutine type of the asynchronous map operations, it can be \c co_await ed from any coroutine.
+	 * 
+	 * \details The operation does not start until it is awaited or \c start is called. When it finishes it resumes whoever awaited it.
+	 * \note The task must outlive the operation, and the map must outlive the task.
+	 */
+	class task {
+		public:
+			/**
+			 * \brief The promise of a \c task.
+			 */
+			struct promise_type {
+				std::coroutine_handle<> waiting; ///< \c waiting is the coroutine that awaited the task, if any.
+				std::exception_ptr      error;   ///< \c error is the exception the operation ended with, if any.
+				
+				/**
+				 * \brief The awaitable that resumes \c waiting once the operation finishes.
+				 */
+				struct finish {
+					bool await_ready() const noexcept {
+						return false;
+					}
+					std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> self) const noexcept {
+						std::coroutine_handle<> next = self.promise().waiting;
+						return next ? next : std::noop_coroutine();
+					}
+					void await_resume() const noexcept {}
+				};
+				
+				task get_return_object() {
+					return task(std::coroutine_handle<promise_type>::from_promise(*this));
+				}
+				std::suspend_always initial_suspend() const noexcept {
+					return {};
+				}
+				finish final_suspend() const noexcept {
+					return {};
+				}
+				void return_void() const noexcept {}
+				void unhandled_exception() {
+					error = std::current_exception();
+				}
+			};
+			
+			task(task&&) noexcept;
+			task& operator= (task&&) = delete;
+			~task();
+			
+			bool                    await_ready() const noexcept;
+			std::coroutine_handle<> await_suspend(std::coroutine_handle<>) noexcept;
+			void                    await_resume() const;
+			void                    start();
+			bool                    done() const;
+		protected:
+			std::coroutine_handle<promise_type> handle; ///< \c handle is the operation.
+			
+			explicit task(std::coroutine_handle<promise_type>);
+	};
+	
+	/**
+	 *  \brief Constructor.
+	 * 
+	 *  \param [in] operation is the suspended operation, the task owns it.
+	 */
+	inline task::task(std::coroutine_handle<promise_type> operation) : handle(operation) {}
+	
+	/**
+	 *  \brief Move constructor.
+	 * 
+	 *  \param [in] other is the task to take the operation from.
+	 */
+	inline task::task(task&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+	
+	/**
+	 *  \brief Destructor.
+	 *  
+	 *  \details This destroys the operation, it must not be suspended on an event loop at the time.
+	 */
+	inline task::~task() {
+		if (handle) {
+			handle.destroy();
+		}
+	}
+	
+	/**
+	 * \brief This checks whether the operation has already finished.
+	 * 
+	 * \return Returns \c true if awaiting does not need to suspend.
+	 */
+	inline bool task::await_ready() const noexcept {
+		return !handle || handle.done();
+	}
+	
+	/**
+	 * \brief This starts the operation, it resumes \c waiting once it finishes.
+	 * 
+	 * \param [in] waiting is the coroutine awaiting the task.
+	 * \return Returns the operation to run next.
+	 */
+	inline std::coroutine_handle<> task::await_suspend(std::coroutine_handle<> waiting) noexcept {
+		handle.promise().waiting = waiting;
+		return handle;
+	}
+	
+	/**
+	 * \brief This gives the result of the operation.
+	 * 
+	 * \return Returns \c void, or throws the exception the operation ended with.
+	 */
+	inline void task::await_resume() const {
+		if (handle && handle.promise().error) {
+			std::rethrow_exception(handle.promise().error);
+		}
+	}
+	
+	/**
+	 * \brief This starts the operation without awaiting it, for code that is not a coroutine.
+	 * 
+	 * \return Returns \c void.
+	 * 
+	 * \details The operation runs until it first suspends, the event loop resumes it from there.
+	 */
+	inline void task::start() {
+		handle.resume();
+	}
+	
+	/**
+	 * \brief This checks whether the operation has finished.
+	 * 
+	 * \return Returns \c true once the operation has finished.
+	 */
+	inline bool task::done() const {
+		return !handle || handle.done();
+	}
+	
+	/**
+	 * \brief The coroutine type of an asynchronous sequence, each item is read with \c co_await \c next().
+	 * 
+	 * \details The sequence runs each time an item is asked for, until it yields the item. It may also suspend on an event loop in between, and the item is then given once it is resumed.
+	 * \note The generator must outlive its items being read, and the map must outlive the generator.
+	 */
+	template <class T>
+	class async_generator {
+		public:
+			struct promise_type;
+			
+			/**
+			 * \brief The awaitable that goes back to the reader when an item is ready or the sequence ends.
+			 */
+			struct handoff {
+				bool await_ready() const noexcept {
+					return false;
+				}
+				std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> self) const noexcept {
+					return self.promise().reader;
+				}
+				void await_resume() const noexcept {}
+			};
+			
+			/**
+			 * \brief The promise of an \c async_generator.
+			 */
+			struct promise_type {
+				std::optional<T>        current; ///< \c current is the item that was just yielded.
+				std::coroutine_handle<> reader;  ///< \c reader is the coroutine waiting for the next item.
+				std::exception_ptr      error;   ///< \c error is the exception the sequence ended with, if any.
+				
+				async_generator get_return_object() {
+					return async_generator(std::coroutine_handle<promise_type>::from_promise(*this));
+				}
+				std::suspend_always initial_suspend() const noexcept {
+					return {};
+				}
+				handoff final_suspend() const noexcept {
+					return {};
+				}
+				handoff yield_value(T item) {
+					current.emplace(std::move(item));
+					return {};
+				}
+				void return_void() const noexcept {}
+				void unhandled_exception() {
+					error = std::current_exception();
+				}
+			};
+			
+			/**
+			 * \brief The awaitable returned by \c next.
+			 */
+			struct advance {
+				std::coroutine_handle<promise_type> handle; ///< \c handle is the sequence.
+				
+				bool await_ready() const noexcept {
+					return !handle || handle.done();
+				}
+				std::coroutine_handle<> await_suspend(std::coroutine_handle<> reader) const noexcept {
+					handle.promise().reader = reader;
+					return handle;
+				}
+				std::optional<T> await_resume() const {
+					std::optional<T> item;
+					if (handle) {
+						if (handle.promise().error) {
+							std::rethrow_exception(handle.promise().error);
+						}
+						item.swap(handle.promise().current);
+					}
+					return item;
+				}
+			};
+			
+			async_generator(async_generator&&) noexcept;
+			async_generator& operator= (async_generator&&) = delete;
+			~async_generator();
+			
+			advance next();
+		protected:
+			std::coroutine_handle<promise_type> handle; ///< \c handle is the sequence.
+			
+			explicit async_generator(std::coroutine_handle<promise_type>);
+	};
+	
+	/**
+	 *  \brief Constructor.
+	 * 
+	 *  \param [in] sequence is the suspended sequence, the generator owns it.
+	 */
+	template <class T>
+	async_generator<T>::async_generator(std::coroutine_handle<promise_type> sequence) : handle(sequence) {}
+	
+	/**
+	 *  \brief Move constructor.
+	 * 
+	 *  \param [in] other is the generator to take the sequence from.
+	 */
+	template <class T>
+	async_generator<T>::async_generator(async_generator&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+	
+	/**
+	 *  \brief Destructor.
+	 *  
+	 *  \details This destroys the sequence, it must not be suspended on an event loop at the time.
+	 */
+	template <class T>
+	async_generator<T>::~async_generator() {
+		if (handle) {
+			handle.destroy();
+		}
+	}
+	
+	/**
+	 * \brief This asks for the next item.
+	 * 
+	 * \return Returns an awaitable giving the item, or an empty \c std::optional once the sequence has ended.
+	 */
+	template <class T>
+	typename async_generator<T>::advance async_generator<T>::next() {
+		return advance{handle};
+	}
+	
+	/**
+	 * \brief This erases every entry whose value is a default value, suspending on the event loop as it goes.
+	 * 
+	 * \param [in,out] out is the map to compact.
+	 * \param [in] is_default is \c true for values that are not to be saved.
+	 * \param [in] how is how often to suspend.
+	 * \return Returns the operation.
+	 * 
+	 * \details The map may be changed while the operation is suspended, so it only keeps the key it stopped at and finds its place again with \c lower_bound when it is resumed.
+	 * \details It suspends after exactly every \c how.items entries it checks, the same rule \c entry_steps uses for the entries it gives.
+	 */
+	template <class Map, class IsDefault>
+	task compact_steps(Map& out, IsDefault is_default, pacing how) {
+		std::size_t since = 0;
+		for (auto it = out.begin(); it != out.end(); ) {
+			if (is_default((*it).second)) {
+				it = out.erase(it);
+			} else {
+				std::advance(it, 1);
+			}
+			if (how.post && (++since >= std::max<std::size_t>(how.items, 1)) && (it != out.end())) {
+				typename Map::key_type key = (*it).first;
+				since = 0;
+				co_await pace{how};
+				it = out.lower_bound(key);
+			}
+		}
+	}
+	
+	/**
+	 * \brief This gives every entry whose value is not a default value, in key order, suspending on the event loop as it goes.
+	 * 
+	 * \param [in] in is the map to read.
+	 * \param [in] is_default is \c true for values that are skipped.
+	 * \param [in] how is how often to suspend.
+	 * \return Returns the sequence of copies of the entries.
+	 * 
+	 * \details The map may be changed between items, so the sequence only keeps the last key it gave and finds the next entry with \c upper_bound.
+	 */
+	template <class Map, class IsDefault>
+	async_generator<std::pair<typename Map::key_type, typename Map::mapped_type>> entry_steps(const Map& in, IsDefault is_default, pacing how) {
+		std::size_t since = 0;
+		for (auto it = in.begin(); it != in.end(); ) {
+			if (is_default((*it).second)) {
+				std::advance(it, 1);
+				continue;
+			}
+			typename Map::key_type key = (*it).first;
+			co_yield std::pair<typename Map::key_type, typename Map::mapped_type>(key, (*it).second);
+			it = in.upper_bound(key);
+			if (how.post && (++since >= std::max<std::size_t>(how.items, 1)) && (it != in.end())) {
+				since = 0;
+				co_await pace{how};
+				it = in.upper_bound(key);
+			}
+		}
+	}
+#endif
+	
+	template <class A, class B, class Allocator = std::allocator<std::pair<const A, B>>>
+	class transaction;
+	
+	/**
+	 * \brief The memory saving version of \c std::map<A, B>.
+	 * 
+	 * \details This class uses \ref null "extended::null<A>" to define a \c default_value for the \c std::map<A, B> unless it is changed in the constructor, then, it does not save items equal to the \c default_value and all values that are not defined will be defined as the \c default_value.
+	 * \details The entries are made with \c Allocator, \ref pmr::map "extended::pmr::map<A, B>" makes them through a \c std::pmr::memory_resource.
+	 * \note All of the \c map<A, B> operators and functions are left unchanged, so there will not be any conflicts, however, many operations will use new operators to make use of this class.
+	 * \note A version of this class exists solely because \c std::string does not work like other objects, if you are using this code as a base for an application that acts like \c std::string, I would suggest making a version of the class to suit your needs better.
+	 */
+	template <class A, class B, class Allocator = std::allocator<std::pair<const A, B>>>
+	class map : public std::map<A, B, std::less<A>, Allocator> {
+		friend class transaction<A, B, Allocator>;
+		protected:
+			B default_value = null<B>::value; ///< \c default_value is what stores the values to be ignored, this CANNOT be changed after the constructor to prevent data loss.
+			filter<A>               key_filter; ///< \c key_filter remembers which keys may be in the map, it is only used after \c use_filter is called.
+			mutable filter_counters key_stats;  ///< \c key_stats counts how often \c key_filter answered \c operator>> , reads only add to it atomically.
+			
+			void note_key(const A&);
+			void rebuild_filter();
+		public:
+			map();
+			map(B);
+			map(B, const Allocator&);
+			template<class... Args> map(B, Args...);
+			template<class InputIt> map(B, InputIt, InputIt, bulk, const Allocator& = Allocator());
+			
+			B    operator>> (A);
+			void operator() (std::pair<A, B>);
+			void operator<< (std::pair<A, B>);
+			void operator!  ();
+			
+			template<class InputIt> void apply_batch(InputIt, InputIt);
+#if __cplusplus >= 202002L
+			void apply_batch(std::span<const std::pair<A, B>>);
+#endif
+			template<class KeyIt, class OutIt> void get_many(KeyIt, KeyIt, OutIt) const;
+#if __cplusplus >= 202002L
+			void get_many(std::span<const A>, std::span<B>) const;
+#endif
+			
+			void compact(std::size_t = 0);
+			layout_stats layout() const;
+			std::pair<layout_stats, layout_stats> relayout(bool = true);
+			template<class F> void for_each(execution, F);
+			template<class F> void transform_values(execution, F);
+			template<class T, class F, class Combine> T reduce(execution, T, F, Combine) const;
+#if (__cplusplus >= 202002L) && defined(__cpp_impl_coroutine)
+			task apply_async(std::vector<std::pair<A, B>>, pacing = {});
+			task compact_async(pacing = {});
+			async_generator<std::pair<A, B>> entries_async(pacing = {}) const;
+#endif
+			
+			transaction<A, B, Allocator> begin_transaction();
+			
+			void         use_filter(bool = true);
+			filter_stats stats() const;
+	};
+	/**
+	 * \brief The memory saving version of \c std::map<A, std::string>.
+	 * 
+	 * \details This class uses \ref null "extended::null<A>" to define a \c default_value for the \c std::map<A, std::string> unless it is changed in the constructor, then, it does not save items equal to the \c default_value and all values that are not defined will be defined as the \c default_value.
+	 * \note All of the \c map<A, std::string> operators and functions are left unchanged, so there will not be any conflicts, however, many operations will use new operators to make use of this class.
+	 * \note This version exists solely because \c std::string does not work like other objects, if you are using this code as a base for an application that acts like \c std::string, I would suggest making a version of the class to suit your needs better.
+	 */
+	template <class A, class Allocator>
+	class map <A, std::string, Allocator> : public std::map<A, std::string, std::less<A>, Allocator> {
+		friend class transaction<A, std::string, Allocator>;
+		protected:
+			std::string default_value = null<std::string>::value; ///< \c default_value is what stores the values to be ignored, this CANNOT be changed after the constructor to prevent data loss.
+			filter<A>               key_filter; ///< \c key_filter remembers which keys may be in the map, it is only used after \c use_filter is called.
+			mutable filter_counters key_stats;  ///< \c key_stats counts how often \c key_filter answered \c operator>> , reads only add to it atomically.
+			
+			void note_key(const A&);
+			void rebuild_filter();
+		public:
+			map();
+			map(std::string);
+			map(std::string, const Allocator&);
+			template<class... Args> map(std::string, Args...);
+			template<class InputIt> map(std::string, InputIt, InputIt, bulk, const Allocator& = Allocator());
+			
+			std::string operator>> (A);
+			void        operator() (std::pair<A, std::string>);
+			void        operator<< (std::pair<A, std::string>);
+			void        operator!  ();
+			
+			template<class InputIt> void apply_batch(InputIt, InputIt);
+#if __cplusplus >= 202002L
+			void apply_batch(std::span<const std::pair<A, std::string>>);
+#endif
+			template<class KeyIt, class OutIt> void get_many(KeyIt, KeyIt, OutIt) const;
+#if __cplusplus >= 202002L
+			void get_many(std::span<const A>, std::span<std::string>) const;
+#endif
+			
+			void compact(std::size_t = 0);
+			layout_stats layout() const;
+			std::pair<layout_stats, layout_stats> relayout(bool = true);
+			template<class F> void for_each(execution, F);
+			template<class F> void transform_values(execution, F);
+			template<class T, class F, class Combine> T reduce(execution, T, F, Combine) const;
+#if (__cplusplus >= 202002L) && defined(__cpp_impl_coroutine)
+			task apply_async(std::vector<std::pair<A, std::string>>, pacing = {});
+			task compact_async(pacing = {});
+			async_generator<std::pair<A, std::string>> entries_async(pacing = {}) const;
+#endif
+			
+			transaction<A, std::string, Allocator> begin_transaction();
+			
+			void         use_filter(bool = true);
+			filter_stats stats() const;
+	};
+	
+	/**
+	 *  \brief Default constructor
+	 *  
+	 *  \details This default constructor does nothing except call the \c std::map<A, B> default constructor
+	 */
+	template <class A, class B, class Allocator>
+	map<A, B, Allocator>::map() : std::map<A, B, std::less<A>, Allocator>() {}
+	
+	/**
+	 *  \brief Constructor.
+	 * 
+	 *  \param [in] default_val is the \c default_value for this \c extended::map<A, B>.
+	 * 
+	 *  \details This constructor calls the \c std::map<A, B> default constructor and sets \c default_value to \c default_val.
+	 */
+	template <class A, class B, class Allocator>
+	map<A, B, Allocator>::map(B default_val) : std::map<A, B, std::less<A>, Allocator>() {
+		default_value = default_val;
+	}
+	
+	/**
+	 *  \brief Allocator constructor.
+	 * 
+	 *  \param [in] default_val is the \c default_value for this \c extended::map<A, B>.
+	 *  \param [in] alloc is the allocator the entries are made with, such as a \c std::pmr::polymorphic_allocator over an arena.
+	 * 
+	 *  \details This constructor calls the \c std::map allocator constructor and sets \c default_value to \c default_val.
+	 */
+	template <class A, class B, class Allocator>
+	map<A, B, Allocator>::map(B default_val, const Allocator& alloc) : std::map<A, B, std::less<A>, Allocator>(alloc) {
+		default_value = default_val;
+	}
+	
+	/**
+	 * \brief Constructor.
+	 * 
+	 * \param [in] default_val is the \c default_value for this \c extended::map<A, B>.
+	 * \param [in] args are the arguments to be sent to the \c std::map<A, B> default constructor
+	 * 
+	 * \details This constructor calls the \c std::map<A, B> constructor, while passing \c args to it and sets \c default_value to \c default_val.
+	 */
+	template <class A, class B, class Allocator>
+	template <class... Args>
+	map<A, B, Allocator>::map(B default_val, Args... args) : std::map<A, B, std::less<A>, Allocator>(args...) {
+		default_value = default_val;
+	}
+	
+	/**
+	 * \brief Bulk constructor.
+	 * 
+	 * \param [in] default_val is the \c default_value for this \c extended::map<A, B>.
+	 * \param [in] first is the start of the range of pairs to load.
+	 * \param [in] last is the end of the range of pairs to load.
+	 * \param [in] how says if the range is already sorted and if the sort may run in parallel.
+	 * \param [in] alloc is the allocator the entries are made with.
+	 * 
+	 * \details This constructor sorts the range if needed, then builds the map in one ordered pass, dropping any pair whose value is the \c default_value. When a key is repeated the last pair in the range wins. With \c how.parallel large ranges are sorted and built in parts on separate threads.
+	 */
+	template <class A, class B, class Allocator>
+	template <class InputIt>
+	map<A, B, Allocator>::map(B default_val, InputIt first, InputIt last, bulk how, const Allocator& alloc) : std::map<A, B, std::less<A>, Allocator>(alloc) {
+		default_value = default_val;
+		std::size_t threads = how.parallel ? how.threads : 1;
+		std::vector<std::pair<A, B>> items(first, last);
+		if (!how.sorted) {
+			sort_pairs(items, (*this).key_comp(), threads);
+		}
+		build_parallel(*this, items, [this](const B& value) { return value == default_value; }, threads);
+	}
+	
+	
+	
+	/**
+	 * \brief This adds a read only \c operator[] using \c operator>> to "pull" out the value.
+	 * 
+	 * \param [in] input is the location of the desired value.
+	 * \return Returns the value of the location if it exists, however, if it does not exist, it will return the \c default_value.
+	 */
+	template <class A, class B, class Allocator>
+	B map<A, B, Allocator>::operator>> (A input) {
+		if (key_filter.enabled()) {
+			key_stats.lookups.fetch_add(1, std::memory_order_relaxed);
+			if (!key_filter.contains(input)) {
+				key_stats.skipped.fetch_add(1, std::memory_order_relaxed);
+				return default_value;
+			}
+		}
+		auto it = (*this).find(input);
+		if (it != (*this).end()) {
+			return (*it).second;
+		}
+		if (key_filter.enabled()) {
+			key_stats.false_positives.fetch_add(1, std::memory_order_relaxed);
+		}
+		return default_value;
+	}
+	
+	/**
+	 * \brief This adds a pair to the map if and only if the first value is already in use or the second value is not the \c default_value.
+	 * 
+	 * \param [in] input is the pair of the location and the desired value.
+	 * \return Returns \c void.
+	 */
+	template <class A, class B, class Allocator>
+	void map<A, B, Allocator>::operator() (std::pair<A, B> input) {
+		if (((*this).count(input.first) > 0) || (input.second != default_value)) {
+			(*this).operator[](input.first) = input.second;
+			(*this).note_key(input.first);
+		}
+	}
+	
+	/**
+	 * \brief This adds a pair to the map if and only if the second value is not the \c default_value, if it is \c default_value, then it will also erase the entry.
+	 * 
+	 * \param [in] input is the pair of the location and the desired value.
+	 * \return Returns \c void.
+	 */
+	template <class A, class B, class Allocator>
+	void map<A, B, Allocator>::operator<< (std::pair<A, B> input) {
+		if (input.second != default_value) {
+			(*this).operator[](input.first) = input.second;
+			(*this).note_key(input.first);
+		} else if ((*this).count(input.first) > 0) {
+			auto it = (*this).begin();
+			it = (*this).find(input.first);
+			(*this).erase(it);
+		}
+	}
+	
+	/**
+	 * \brief This removes any \c default_value from the map by erasing the entry.
+	 * 
+	 * \return Returns \c void.
+	 */
+	template <class A, class B, class Allocator>
+	void map<A, B, Allocator>::operator! () {
+		(*this).compact(1);
+	}
+	
+	/**
+	 * \brief This removes any \c default_value from the map by erasing the entry, checking parts of the map on separate threads.
+	 * 
+	 * \param [in] threads is the most threads to use, \c 0 uses one per thread of the shared \c extended::pool and one for the calling thread.
+	 * \return Returns \c void.
+	 * 
+	 * \details The entries are erased on the calling thread once every part has been checked, small maps are always compacted on the calling thread.
+	 */
+	template <class A, class B, class Allocator>
+	void map<A, B, Allocator>::compact(std::size_t threads) {
+		compact_map(*this, [this](const B& value) { return value == default_value; }, threads);
+		if (key_filter.enabled()) {
+			(*this).rebuild_filter();
+		}
+	}
+	
+	/**
+	 * \brief This measures how the nodes of the map are laid out in memory.
+	 * 
+	 * \return Returns the layout, see \c relayout.
+	 */
+	template <class A, class B, class Allocator>
+	layout_stats map<A, B, Allocator>::layout() const {
+		return measure_layout(*this);
+	}
+	
+	/**
+	 * \brief This lays the map out again in key order in fresh memory, so in order scans read nearby nodes.
+	 * 
+	 * \param [in] compact is \c true to also remove any \c default_value, doing the work of \c operator! in the same pass.
+	 * \return Returns the layout before and after.
+	 * 
+	 * \details Every entry is copied into a new node, all of the new nodes are made before the old ones are freed so they come from fresh memory in key order. If the copies are no better laid out and nothing was dropped the old nodes are kept, so the layout never gets worse. Iterators and references to entries should be taken as no longer valid afterwards.
+	 */
+	template <class A, class B, class Allocator>
+	std::pair<layout_stats, layout_stats> map<A, B, Allocator>::relayout(bool compact) {
+		layout_stats before = (*this).layout();
+		relayout_map(*this, [this](const B& value) { return value == default_value; }, compact);
+		if (compact && key_filter.enabled()) {
+			(*this).rebuild_filter();
+		}
+		return std::pair<layout_stats, layout_stats>(before, (*this).layout());
+	}
+	
+	/**
+	 * \brief This calls a function on every entry that is not the \c default_value.
+	 * 
+	 * \param [in] how is how the calls are run, \c execution::parallel splits the map into even key ranges on separate threads.
+	 * \param [in] f is called as \c f(key, value), for \c execution::parallel it must be safe to call from several threads at once.
+	 * \return Returns \c void.
+	 * 
+	 * \note \c f may change the value, values changed to the \c default_value stay until \c operator! is used.
+	 */
+	template <class A, class B, class Allocator>
+	template <class F>
+	void map<A, B, Allocator>::for_each(execution how, F f) {
+		map_for_each(*this, how, f);
+	}
+	
+	/**
+	 * \brief This replaces every value with a function of its entry, erasing entries that become the \c default_value.
+	 * 
+	 * \param [in] how is how the calls are run.
+	 * \param [in] f is called as \c f(key, value) and returns the new value, for \c execution::parallel it must be safe to call from several threads at once.
+	 * \return Returns \c void.
+	 */
+	template <class A, class B, class Allocator>
+	template <class F>
+	void map<A, B, Allocator>::transform_values(execution how, F f) {
+		map_transform(*this, how, f, [this](const B& value) { return value == default_value; });
+	}
+	
+	/**
+	 * \brief This combines a function of every entry into one result.
+	 * 
+	 * \param [in] how is how the calls are run.
+	 * \param [in] init is the starting result.
+	 * \param [in] f is called as \c f(key, value) and returns what that entry adds to the result.
+	 * \param [in] combine is called as \c combine(result, part) and returns the combined result, for \c execution::parallel it must be associative.
+	 * \return Returns the result.
+	 */
+	template <class A, class B, class Allocator>
+	template <class T, class F, class Combine>
+	T map<A, B, Allocator>::reduce(execution how, T init, F f, Combine combine) const {
+		return map_reduce(*this, how, init, f, combine);
+	}
+	
+#if (__cplusplus >= 202002L) && defined(__cpp_impl_coroutine)
+	/**
+	 * \brief This is the awaitable version of \c apply_batch, it suspends on the event loop between parts of the batch.
+	 * 
+	 * \param [in] batch is the pairs to apply, they are applied as if each was given to \c operator<< in order.
+	 * \param [in] how is how often to suspend.
+	 * \return Returns the operation, it starts once it is awaited.
+	 * 
+	 * \details The batch is sorted once and then merged \c how.items pairs at a time. A repeated key that falls in two parts is simply written twice in order, so the last write still wins. The map may be changed while the operation is suspended.
+	 */
+	template <class A, class B, class Allocator>
+	task map<A, B, Allocator>::apply_async(std::vector<std::pair<A, B>> batch, pacing how) {
+		auto is_default = [this](const B& value) { return value == default_value; };
+		sort_pairs(batch, (*this).key_comp(), 1);
+		std::size_t step = how.post ? std::max<std::size_t>(how.items, 1) : std::max<std::size_t>(batch.size(), 1);
+		for (std::size_t begin = 0; begin < batch.size(); begin += step) {
+			if (begin > 0) {
+				co_await pace{how};
+			}
+			std::size_t end = std::min(batch.size(), begin + step);
+			if (key_filter.enabled()) {
+				for (std::size_t i = begin; i < end; i++) {
+					if (!is_default(batch[i].second)) {
+						key_filter.insert(batch[i].first);
+					}
+				}
+			}
+			merge_sorted(*this, batch.begin() + begin, batch.begin() + end, is_default);
+			if (key_filter.full()) {
+				(*this).rebuild_filter();
+			}
+		}
+	}
+	
+	/**
+	 * \brief This is the awaitable version of \c operator!, it suspends on the event loop every \c how.items entries.
+	 * 
+	 * \param [in] how is how often to suspend.
+	 * \return Returns the operation, it starts once it is awaited.
+	 */
+	template <class A, class B, class Allocator>
+	task map<A, B, Allocator>::compact_async(pacing how) {
+		co_await compact_steps(*this, [this](const B& value) { return value == default_value; }, how);
+		if (key_filter.enabled()) {
+			(*this).rebuild_filter();
+		}
+	}
+	
+	/**
+	 * \brief This gives every entry that is not the \c default_value in key order, suspending on the event loop every \c how.items entries.
+	 * 
+	 * \param [in] how is how often to suspend.
+	 * \return Returns the sequence, each entry is read with \c co_await \c entries.next().
+	 * 
+	 * \note Each entry is a copy, the map may be changed between entries and the sequence carries on after the last key it gave.
+	 */
+	template <class A, class B, class Allocator>
+	async_generator<std::pair<A, B>> map<A, B, Allocator>::entries_async(pacing how) const {
+		return entry_steps(*this, [this](const B& value) { return value == default_value; }, how);
+	}
+#endif
+	
+	/**
+	 * \brief This applies a batch of pairs as if each was given to \c operator<< in order.
+	 * 
+	 * \param [in] first is the start of the range of pairs to apply.
+	 * \param [in] last is the end of the range of pairs to apply.
+	 * \return Returns \c void.
+	 * 
+	 * \details The batch is sorted and repeated keys are collapsed so the last write wins, then it is merged into the map in one ordered pass. Pairs with the \c default_value erase their key.
+	 */
+	template <class A, class B, class Allocator>
+	template <class InputIt>
+	void map<A, B, Allocator>::apply_batch(InputIt first, InputIt last) {
+		std::vector<std::pair<A, B>> items(first, last);
+		sort_pairs(items, (*this).key_comp(), 1);
+		if (key_filter.enabled()) {
+			for (std::size_t i = 0; i < items.size(); i++) {
+				if (items[i].second != default_value) {
+					key_filter.insert(items[i].first);
+				}
+			}
+		}
+		merge_sorted(*this, items.begin(), items.end(), [this](const B& value) { return value == default_value; });
+		if (key_filter.full()) {
+			(*this).rebuild_filter();
+		}
+	}
+	
+#if __cplusplus >= 202002L
+	/**
+	 * \brief This applies a batch of pairs as if each was given to \c operator<< in order.
+	 * 
+	 * \param [in] batch is the pairs to apply.
+	 * \return Returns \c void.
+	 * 
+	 * \details This is the same as \c apply_batch(batch.begin(), batch.end()).
+	 */
+	template <class A, class B, class Allocator>
+	void map<A, B, Allocator>::apply_batch(std::span<const std::pair<A, B>> batch) {
+		(*this).apply_batch(batch.begin(), batch.end());
+	}
+#endif
+	
+	/**
+	 * \brief This works like \c operator>> for a whole list of keys at once.
+	 * 
+	 * \param [in] first is the start of the keys to look up, it must be a random access iterator.
+	 * \param [in] last is the end of the keys to look up.
+	 * \param [out] out is the start of where the values are written, one for each key.
+	 * \return Returns \c void.
+	 * 
+	 * \details Keys that are not in the map are given the \c default_value. Sorted keys are answered with a single forward walk of the map.
+	 */
+	template <class A, class B, class Allocator>
+	template <class KeyIt, class OutIt>
+	void map<A, B, Allocator>::get_many(KeyIt first, KeyIt last, OutIt out) const {
+		lookup_many(*this, first, last, out, default_value);
+	}
+	
+#if __cplusplus >= 202002L
+	/**
+	 * \brief This works like \c operator>> for a whole list of keys at once.
+	 * 
+	 * \param [in] keys is the keys to look up.
+	 * \param [out] out is where the values are written, it must be at least as long as \c keys.
+	 * \return Returns \c void.
+	 * 
+	 * \details This is the same as \c get_many(keys.begin(), keys.end(), out.begin()).
+	 */
+	template <class A, class B, class Allocator>
+	void map<A, B, Allocator>::get_many(std::span<const A> keys, std::span<B> out) const {
+		(*this).get_many(keys.begin(), keys.end(), out.begin());
+	}
+#endif
+	
+	/**
+	 * \brief This adds a key that was just saved to the filter, rebuilding the filter larger if it is full.
+	 * 
+	 * \param [in] key is the key that was saved.
+	 * \return Returns \c void.
+	 */
+	template <class A, class B, class Allocator>
+	void map<A, B, Allocator>::note_key(const A& key) {
+		if (key_filter.enabled()) {
+			key_filter.insert(key);
+			if (key_filter.full()) {
+				(*this).rebuild_filter();
+			}
+		}
+	}
+	
+	/**
+	 * \brief This rebuilds the filter from the keys in the map, forgetting keys that were erased.
+	 * 
+	 * \return Returns \c void.
+	 */
+	template <class A, class B, class Allocator>
+	void map<A, B, Allocator>::rebuild_filter() {
+		key_filter.reset((*this).size() * 2);
+		for (auto it = (*this).cbegin(); it != (*this).cend(); std::advance(it, 1)) {
+			key_filter.insert((*it).first);
+		}
+	}
+	
+	/**
+	 * \brief This turns the key filter in front of \c operator>> on or off.
+	 * 
+	 * \param [in] on is \c true to build the filter from the keys in the map, \c false to free it.
+	 * \return Returns \c void.
+	 * 
+	 * \details While the filter is on, lookups of most missing keys return the \c default_value after checking one cache line. The filter follows \c operator(), \c operator<<, \c apply_batch and \c operator!, if the map is changed through the \c std::map functions instead, call this again or \c operator! to rebuild it.
+	 * \note The filter needs \c std::hash\<A\>, for other key types it is never used.
+	 */
+	template <class A, class B, class Allocator>
+	void map<A, B, Allocator>::use_filter(bool on) {
+		key_stats.reset();
+		if (on && hashable<A>::value) {
+			(*this).rebuild_filter();
+		} else {
+			key_filter.clear();
+		}
+	}
+	
+	/**
+	 * \brief This gets how well the key filter has been working.
+	 * 
+	 * \return Returns the counts since the filter was last turned on.
+	 */
+	template <class A, class B, class Allocator>
+	filter_stats map<A, B, Allocator>::stats() const {
+		return key_stats.load();
+	}
+	
+	
+	/**
+	 *  \brief Default constructor
+	 *  
+	 *  \details This default constructor does nothing except call the \c std::map<A, std::string> default constructor
+	 */
+	template <class A, class Allocator>
+	map<A, std::string, Allocator>::map() : std::map<A, std::string, std::less<A>, Allocator>() {}
+	
+	/**
+	 *  \brief Constructor.
+	 * 
+	 *  \param [in] default_val is the \c default_value for this \c extended::map<A, std::string>.
+	 * 
+	 *  \details This constructor calls the \c std::map<A, std::string> default constructor and sets \c default_value to \c default_val.
+	 */
+	template <class A, class Allocator>
+	map<A, std::string, Allocator>::map(std::string default_val) : std::map<A, std::string, std::less<A>, Allocator>() {
+		default_value = default_val;
+	}
+	
+	/**
+	 *  \brief Allocator constructor.
+	 * 
+	 *  \param [in] default_val is the \c default_value for this \c extended::map<A, std::string>.
+	 *  \param [in] alloc is the allocator the entries are made with, such as a \c std::pmr::polymorphic_allocator over an arena.
+	 * 
+	 *  \details This constructor calls the \c std::map allocator constructor and sets \c default_value to \c default_val.
+	 */
+	template <class A, class Allocator>
+	map<A, std::string, Allocator>::map(std::string default_val, const Allocator& alloc) : std::map<A, std::string, std::less<A>, Allocator>(alloc) {
+		default_value = default_val;
+	}
+	
+	/**
+	 * \brief Constructor.
+	 * 
+	 * \param [in] default_val is the \c default_value for this \c extended::map<A, std::string>.
+	 * \param [in] args are the arguments to be sent to the \c std::map<A, std::string> default constructor
+	 * 
+	 * 
+	 * \details This constructor calls the \c std::map<A, std::string> constructor, while passing \c args to it and sets \c default_value to \c default_val.
+	 */
+	template <class A, class Allocator>
+	template<class... Args>
+	map<A, std::string, Allocator>::map(std::string default_val, Args... args) : std::map<A, std::string, std::less<A>, Allocator>(args...){
+		default_value = default_val;
+	}
+	
+	/**
+	 * \brief Bulk constructor.
+	 * 
+	 * \param [in] default_val is the \c default_value for this \c extended::map<A, std::string>.
+	 * \param [in] first is the start of the range of pairs to load.
+	 * \param [in] last is the end of the range of pairs to load.
+	 * \param [in] how says if the range is already sorted and if the sort may run in parallel.
+	 * \param [in] alloc is the allocator the entries are made with.
+	 * 
+	 * \details This constructor sorts the range if needed, then builds the map in one ordered pass, dropping any pair whose value is the \c default_value. When a key is repeated the last pair in the range wins. With \c how.parallel large ranges are sorted and built in parts on separate threads.
+	 */
+	template <class A, class Allocator>
+	template <class InputIt>
+	map<A, std::string, Allocator>::map(std::string default_val, InputIt first, InputIt last, bulk how, const Allocator& alloc) : std::map<A, std::string, std::less<A>, Allocator>(alloc) {
+		default_value = default_val;
+		std::size_t threads = how.parallel ? how.threads : 1;
+		std::vector<std::pair<A, std::string>> items(first, last);
+		if (!how.sorted) {
+			sort_pairs(items, (*this).key_comp(), threads);
+		}
+		build_parallel(*this, items, [this](const std::string& value) { return value.compare(default_value) == 0; }, threads);
+	}
+	
+	/**
+	 * \brief This adds a pair to the map if and only if the first value is already in use or the second value is not the default_value.
+	 * 
+	 * \param [in] input is the pair of the location and the desired value.
+	 * \return Returns \c void.
+	 */
+	template <class A, class Allocator>
+	std::string map<A, std::string, Allocator>::operator>> (A input) {
+		if (key_filter.enabled()) {
+			key_stats.lookups.fetch_add(1, std::memory_order_relaxed);
+			if (!key_filter.contains(input)) {
+				key_stats.skipped.fetch_add(1, std::memory_order_relaxed);
+				return default_value;
+			}
+		}
+		auto it = (*this).find(input);
+		if (it != (*this).end()) {
+			return (*it).second;
+		}
+		if (key_filter.enabled()) {
+			key_stats.false_positives.fetch_add(1, std::memory_order_relaxed);
+		}
+		return default_value;
+	}
+	
+	/**
+	 * \brief This adds a pair to the map if and only if the first value is already in use or the second value is not the \c default_value.
+	 * 
+	 * \param [in] input is the pair of the location and the desired value.
+	 * \return Returns \c void.
+	 */
+	template <class A, class Allocator>
+	void map<A, std::string, Allocator>::operator() (std::pair<A, std::string> input) {
+		if (((*this).count(input.first) > 0) || (input.second != default_value)) {
+			(*this).operator[](input.first) = input.second;
+			(*this).note_key(input.first);
+		}
+	}
+	
+	/**
+	 * \brief This adds a pair to the map if and only if the second value is not the \c default_value, if it is \c default_value, then it will also erase the entry.
+	 * 
+	 * \param [in] input is the pair of the location and the desired value.
+	 * \return Returns \c void.
+	 */
+	template <class A, class Allocator>
+	void map<A, std::string, Allocator>::operator<< (std::pair<A, std::string> input) {
+		if (input.second.compare(default_value) != 0) {
+			(*this).std::map<A, std::string, std::less<A>, Allocator>::operator[](input.first) = input.second;
+			(*this).note_key(input.first);
+		} else if ((*this).std::map<A, std::string, std::less<A>, Allocator>::count(input.first) > 0) {
+			auto it = (*this).std::map<A, std::string, std::less<A>, Allocator>::begin();
+			it = (*this).find(input.first);
+			(*this).std::map<A, std::string, std::less<A>, Allocator>::erase(it);
+		}
+	}
+	
+	/**
+	 * \brief This removes any \c default_value from the map by erasing the entry.
+	 * 
+	 * \return Returns \c void.
+	 */
+	template <class A, class Allocator>
+	void map<A, std::string, Allocator>::operator! () {
+		(*this).compact(1);
+	}
+	
+	/**
+	 * \brief This removes any \c default_value from the map by erasing the entry, checking parts of the map on separate threads.
+	 * 
+	 * \param [in] threads is the most threads to use, \c 0 uses one per thread of the shared \c extended::pool and one for the calling thread.
+	 * \return Returns \c void.
+	 * 
+	 * \details The entries are erased on the calling thread once every part has been checked, small maps are always compacted on the calling thread.
+	 */
+	template <class A, class Allocator>
+	void map<A, std::string, Allocator>::compact(std::size_t threads) {
+		compact_map(*this, [this](const std::string& value) { return value.compare(default_value) == 0; }, threads);
+		if (key_filter.enabled()) {
+			(*this).rebuild_filter();
+		}
+	}
+	
+	/**
+	 * \brief This measures how the nodes of the map are laid out in memory.
+	 * 
+	 * \return Returns the layout, see \c relayout.
+	 */
+	template <class A, class Allocator>
+	layout_stats map<A, std::string, Allocator>::layout() const {
+		return measure_layout(*this);
+	}
+	
+	/**
+	 * \brief This lays the map out again in key order in fresh memory, so in order scans read nearby nodes.
+	 * 
+	 * \param [in] compact is \c true to also remove any \c default_value, doing the work of \c operator! in the same pass.
+	 * \return Returns the layout before and after.
+	 * 
+	 * \details Every entry is copied into a new node, all of the new nodes are made before the old ones are freed so they come from fresh memory in key order. If the copies are no better laid out and nothing was dropped the old nodes are kept, so the layout never gets worse. Iterators and references to entries should be taken as no longer valid afterwards.
+	 */
+	template <class A, class Allocator>
+	std::pair<layout_stats, layout_stats> map<A, std::string, Allocator>::relayout(bool compact) {
+		layout_stats before = (*this).layout();
+		relayout_map(*this, [this](const std::string& value) { return value.compare(default_value) == 0; }, compact);
+		if (compact && key_filter.enabled()) {
+			(*this).rebuild_filter();
+		}
+		return std::pair<layout_stats, layout_stats>(before, (*this).layout());
+	}
+	
+	/**
+	 * \brief This calls a function on every entry that is not the \c default_value.
+	 * 
+	 * \param [in] how is how the calls are run, \c execution::parallel splits the map into even key ranges on separate threads.
+	 * \param [in] f is called as \c f(key, value), for \c execution::parallel it must be safe to call from several threads at once.
+	 * \return Returns \c void.
+	 * 
+	 * \note \c f may change the value, values changed to the \c default_value stay until \c operator! is used.
+	 */
+	template <class A, class Allocator>
+	template <class F>
+	void map<A, std::string, Allocator>::for_each(execution how, F f) {
+		map_for_each(*this, how, f);
+	}
+	
+	/**
+	 * \brief This replaces every value with a function of its entry, erasing entries that become the \c default_value.
+	 * 
+	 * \param [in] how is how the calls are run.
+	 * \param [in] f is called as \c f(key, value) and returns the new value, for \c execution::parallel it must be safe to call from several threads at once.
+	 * \return Returns \c void.
+	 */
+	template <class A, class Allocator>
+	template <class F>
+	void map<A, std::string, Allocator>::transform_values(execution how, F f) {
+		map_transform(*this, how, f, [this](const std::string& value) { return value.compare(default_value) == 0; });
+	}
+	
+	/**
+	 * \brief This combines a function of every entry into one result.
+	 * 
+	 * \param [in] how is how the calls are run.
+	 * \param [in] init is the starting result.
+	 * \param [in] f is called as \c f(key, value) and returns what that entry adds to the result.
+	 * \param [in] combine is called as \c combine(result, part) and returns the combined result, for \c execution::parallel it must be associative.
+	 * \return Returns the result.
+	 */
+	template <class A, class Allocator>
+	template <class T, class F, class Combine>
+	T map<A, std::string, Allocator>::reduce(execution how, T init, F f, Combine combine) const {
+		return map_reduce(*this, how, init, f, combine);
+	}
+	
+#if (__cplusplus >= 202002L) && defined(__cpp_impl_coroutine)
+	/**
+	 * \brief This is the awaitable version of \c apply_batch, it suspends on the event loop between parts of the batch.
+	 * 
+	 * \param [in] batch is the pairs to apply, they are applied as if each was given to \c operator<< in order.
+	 * \param [in] how is how often to suspend.
+	 * \return Returns the operation, it starts once it is awaited.
+	 * 
+	 * \details The batch is sorted once and then merged \c how.items pairs at a time. A repeated key that falls in two parts is simply written twice in order, so the last write still wins. The map may be changed while the operation is suspended.
+	 */
+	template <class A, class Allocator>
+	task map<A, std::string, Allocator>::apply_async(std::vector<std::pair<A, std::string>> batch, pacing how) {
+		auto is_default = [this](const std::string& value) { return value.compare(default_value) == 0; };
+		sort_pairs(batch, (*this).key_comp(), 1);
+		std::size_t step = how.post ? std::max<std::size_t>(how.items, 1) : std::max<std::size_t>(batch.size(), 1);
+		for (std::size_t begin = 0; begin < batch.size(); begin += step) {
+			if (begin > 0) {
+				co_await pace{how};
+			}
+			std::size_t end = std::min(batch.size(), begin + step);
+			if (key_filter.enabled()) {
+				for (std::size_t i = begin; i < end; i++) {
+					if (!is_default(batch[i].second)) {
+						key_filter.insert(batch[i].first);
+					}
+				}
+			}
+			merge_sorted(*this, batch.begin() + begin, batch.begin() + end, is_default);
+			if (key_filter.full()) {
+				(*this).rebuild_filter();
+			}
+		}
+	}
+	
+	/**
+	 * \brief This is the awaitable version of \c operator!, it suspends on the event loop every \c how.items entries.
+	 * 
+	 * \param [in] how is how often to suspend.
+	 * \return Returns the operation, it starts once it is awaited.
+	 */
+	template <class A, class Allocator>
+	task map<A, std::string, Allocator>::compact_async(pacing how) {
+		co_await compact_steps(*this, [this](const std::string& value) { return value.compare(default_value) == 0; }, how);
+		if (key_filter.enabled()) {
+			(*this).rebuild_filter();
+		}
+	}
+	
+	/**
+	 * \brief This gives every entry that is not the \c default_value in key order, suspending on the event loop every \c how.items entries.
+	 * 
+	 * \param [in] how is how often to suspend.
+	 * \return Returns the sequence, each entry is read with \c co_await \c entries.next().
+	 * 
+	 * \note Each entry is a copy, the map may be changed between entries and the sequence carries on after the last key it gave.
+	 */
+	template <class A, class Allocator>
+	async_generator<std::pair<A, std::string>> map<A, std::string, Allocator>::entries_async(pacing how) const {
+		return entry_steps(*this, [this](const std::string& value) { return value.compare(default_value) == 0; }, how);
+	}
+#endif
+	
+	/**
+	 * \brief This applies a batch of pairs as if each was given to \c operator<< in order.
+	 * 
+	 * \param [in] first is the start of the range of pairs to apply.
+	 * \param [in] last is the end of the range of pairs to apply.
+	 * \return Returns \c void.
+	 * 
+	 * \details The batch is sorted and repeated keys are collapsed so the last write wins, then it is merged into the map in one ordered pass. Pairs with the \c default_value erase their key.
+	 */
+	template <class A, class Allocator>
+	template <class InputIt>
+	void map<A, std::string, Allocator>::apply_batch(InputIt first, InputIt last) {
+		std::vector<std::pair<A, std::string>> items(first, last);
+		sort_pairs(items, (*this).key_comp(), 1);
+		if (key_filter.enabled()) {
+			for (std::size_t i = 0; i < items.size(); i++) {
+				if (items[i].second.compare(default_value) != 0) {
+					key_filter.insert(items[i].first);
+				}
+			}
+		}
+		merge_sorted(*this, items.begin(), items.end(), [this](const std::string& value) { return value.compare(default_value) == 0; });
+		if (key_filter.full()) {
+			(*this).rebuild_filter();
+		}
+	}
+	
+#if __cplusplus >= 202002L
+	/**
+	 * \brief This applies a batch of pairs as if each was given to \c operator<< in order.
+	 * 
+	 * \param [in] batch is the pairs to apply.
+	 * \return Returns \c void.
+	 * 
+	 * \details This is the same as \c apply_batch(batch.begin(), batch.end()).
+	 */
+	template <class A, class Allocator>
+	void map<A, std::string, Allocator>::apply_batch(std::span<const std::pair<A, std::string>> batch) {
+		(*this).apply_batch(batch.begin(), batch.end());
+	}
+#endif
+	
+	/**
+	 * \brief This works like \c operator>> for a whole list of keys at once.
+	 * 
+	 * \param [in] first is the start of the keys to look up, it must be a random access iterator.
+	 * \param [in] last is the end of the keys to look up.
+	 * \param [out] out is the start of where the values are written, one for each key.
+	 * \return Returns \c void.
+	 * 
+	 * \details Keys that are not in the map are given the \c default_value. Sorted keys are answered with a single forward walk of the map.
+	 */
+	template <class A, class Allocator>
+	template <class KeyIt, class OutIt>
+	void map<A, std::string, Allocator>::get_many(KeyIt first, KeyIt last, OutIt out) const {
+		lookup_many(*this, first, last, out, default_value);
+	}
+	
+#if __cplusplus >= 202002L
+	/**
+	 * \brief This works like \c operator>> for a whole list of keys at once.
+	 * 
+	 * \param [in] keys is the keys to look up.
+	 * \param [out] out is where the values are written, it must be at least as long as \c keys.
+	 * \return Returns \c void.
+	 * 
+	 * \details This is the same as \c get_many(keys.begin(), keys.end(), out.begin()).
+	 */
+	template <class A, class Allocator>
+	void map<A, std::string, Allocator>::get_many(std::span<const A> keys, std::span<std::string> out) const {
+		(*this).get_many(keys.begin(), keys.end(), out.begin());
+	}
+#endif
+	
+	/**
+	 * \brief This adds a key that was just saved to the filter, rebuilding the filter larger if it is full.
+	 * 
+	 * \param [in] key is the key that was saved.
+	 * \return Returns \c void.
+	 */
+	template <class A, class Allocator>
+	void map<A, std::string, Allocator>::note_key(const A& key) {
+		if (key_filter.enabled()) {
+			key_filter.insert(key);
+			if (key_filter.full()) {
+				(*this).rebuild_filter();
+			}
+		}
+	}
+	
+	/**
+	 * \brief This rebuilds the filter from the keys in the map, forgetting keys that were erased.
+	 * 
+	 * \return Returns \c void.
+	 */
+	template <class A, class Allocator>
+	void map<A, std::string, Allocator>::rebuild_filter() {
+		key_filter.reset((*this).size() * 2);
+		for (auto it = (*this).cbegin(); it != (*this).cend(); std::advance(it, 1)) {
+			key_filter.insert((*it).first);
+		}
+	}
+	
+	/**
+	 * \brief This turns the key filter in front of \c operator>> on or off.
+	 * 
+	 * \param [in] on is \c true to build the filter from the keys in the map, \c false to free it.
+	 * \return Returns \c void.
+	 * 
+	 * \details While the filter is on, lookups of most missing keys return the \c default_value after checking one cache line. The filter follows \c operator(), \c operator<<, \c apply_batch and \c operator!, if the map is changed through the \c std::map functions instead, call this again or \c operator! to rebuild it.
+	 * \note The filter needs \c std::hash\<A\>, for other key types it is never used.
+	 */
+	template <class A, class Allocator>
+	void map<A, std::string, Allocator>::use_filter(bool on) {
+		key_stats.reset();
+		if (on && hashable<A>::value) {
+			(*this).rebuild_filter();
+		} else {
+			key_filter.clear();
+		}
+	}
+	
+	/**
+	 * \brief This gets how well the key filter has been working.
+	 * 
+	 * \return Returns the counts since the filter was last turned on.
+	 */
+	template <class A, class Allocator>
+	filter_stats map<A, std::string, Allocator>::stats() const {
+		return key_stats.load();
+	}
+	
+	/**
+	 * \brief A set of \c operator<< updates to a \ref map "extended::map<A, B>" that are applied all together or not at all.
+	 * 
+	 * \details The updates are kept in a small overlay map made with the allocator of the map, a repeated key keeps its last value. \c commit moves the nodes of the overlay into the map in one sorted pass, \c rollback just empties the overlay without touching the map. Reads through the transaction see its own updates over the map.
+	 * \note A transaction that is destroyed without \c commit is rolled back. The map must not be destroyed while a transaction on it is open.
+	 */
+	template <class A, class B, class Allocator>
+	class transaction {
+		protected:
+			map<A, B, Allocator>*                   base;    ///< \c base is the map the updates are for.
+			std::map<A, B, std::less<A>, Allocator> overlay; ///< \c overlay is the updates that have not been committed, its entries come from the same allocator as the map.
+		public:
+			transaction(map<A, B, Allocator>&);
+			transaction(transaction&&) noexcept;
+			transaction& operator= (transaction&&) = delete;
+			
+			B    operator>> (A);
+			void operator<< (std::pair<A, B>);
+			void commit();
+			void rollback();
+			
+			std::size_t pending() const;
+	};
+	
+	/**
+	 *  \brief Constructor.
+	 * 
+	 *  \param [in] target is the map the updates are for.
+	 */
+	template <class A, class B, class Allocator>
+	transaction<A, B, Allocator>::transaction(map<A, B, Allocator>& target) : base(&target), overlay(target.get_allocator()) {}
+	
+	/**
+	 *  \brief Move constructor.
+	 * 
+	 *  \param [in] other is the transaction to take the updates from, it is left empty.
+	 */
+	template <class A, class B, class Allocator>
+	transaction<A, B, Allocator>::transaction(transaction&& other) noexcept : base(other.base), overlay(std::move(other.overlay)) {
+		other.overlay.clear();
+	}
+	
+	/**
+	 * \brief This is \c extended::map<A, B>::operator>> with the updates of the transaction over the map.
+	 * 
+	 * \param [in] input is the location of the desired value.
+	 * \return Returns the value of the location in the transaction if it was updated, otherwise its value in the map.
+	 */
+	template <class A, class B, class Allocator>
+	B transaction<A, B, Allocator>::operator>> (A input) {
+		auto it = overlay.find(input);
+		if (it != overlay.end()) {
+			return (*it).second;
+		}
+		return (*base) >> input;
+	}
+	
+	/**
+	 * \brief This adds an update to the transaction, nothing in the map changes until \c commit.
+	 * 
+	 * \param [in] input is the pair of the location and the desired value, a \c default_value erases the location on \c commit.
+	 * \return Returns \c void.
+	 */
+	template <class A, class B, class Allocator>
+	void transaction<A, B, Allocator>::operator<< (std::pair<A, B> input) {
+		overlay.insert_or_assign(input.first, input.second);
+	}
+	
+	/**
+	 * \brief This applies every update of the transaction to the map and empties the transaction.
+	 * 
+	 * \return Returns \c void.
+	 * 
+	 * \details The overlay is already sorted with one value per key and its nodes come from the allocator of the map, so it is merged with \c splice_sorted, which only relinks nodes. The key filter is brought up to date first, since rebuilding it may allocate, so if anything throws the map has not been changed at all.
+	 * \note This assumes comparing keys and values and destroying values do not throw.
+	 */
+	template <class A, class B, class Allocator>
+	void transaction<A, B, Allocator>::commit() {
+		map<A, B, Allocator>& target = *base;
+		auto is_default = [&target](const B& value) { return value == target.default_value; };
+		auto note_keys  = [&]() {
+			for (auto it = overlay.begin(); it != overlay.end(); std::advance(it, 1)) {
+				if (!is_default((*it).second)) {
+					target.key_filter.insert((*it).first);
+				}
+			}
+		};
+		if (target.key_filter.enabled()) {
+			note_keys();
+			if (target.key_filter.full()) {
+				target.rebuild_filter();
+				note_keys();
+			}
+		}
+		splice_sorted(target, overlay, is_default);
+	}
+	
+	/**
+	 * \brief This drops every update of the transaction, the map is not touched.
+	 * 
+	 * \return Returns \c void.
+	 */
+	template <class A, class B, class Allocator>
+	void transaction<A, B, Allocator>::rollback() {
+		overlay.clear();
+	}
+	
+	/**
+	 * \brief This counts the keys the transaction has updated.
+	 * 
+	 * \return Returns the number of updated keys.
+	 */
+	template <class A, class B, class Allocator>
+	std::size_t transaction<A, B, Allocator>::pending() const {
+		return overlay.size();
+	}
+	
+	/**
+	 * \brief This starts a transaction on the map.
+	 * 
+	 * \return Returns the transaction, its updates are applied by \c commit.
+	 */
+	template <class A, class B, class Allocator>
+	transaction<A, B, Allocator> map<A, B, Allocator>::begin_transaction() {
+		return transaction<A, B, Allocator>(*this);
+	}
+	
+	/**
+	 * \brief This starts a transaction on the map.
+	 * 
+	 * \return Returns the transaction, its updates are applied by \c commit.
+	 */
+	template <class A, class Allocator>
+	transaction<A, std::string, Allocator> map<A, std::string, Allocator>::begin_transaction() {
+		return transaction<A, std::string, Allocator>(*this);
+	}
+	
+	namespace pmr {
+		/**
+		 * \brief \ref map "extended::map<A, B>" with its entries made through a \c std::pmr::memory_resource, such as a \c std::pmr::monotonic_buffer_resource or a \c std::pmr::unsynchronized_pool_resource.
+		 * 
+		 * \details The resource is given to the allocator constructor, e.g. \c extended::pmr::map<int, std::string> \c m(std::string(), &resource), and \c B of \c std::string still uses the \c std::string version of the class.
+		 */
+		template <class A, class B>
+		using map = extended::map<A, B, std::pmr::polymorphic_allocator<std::pair<const A, B>>>;
+	}
+	
+	/**
+	 * \brief A pool of distinct strings, each known by a 4 byte handle and counted by how many entries use it.
+	 * 
+	 * \details Interning a string that is already in the pool only adds to its count. A string is freed once its count drops to zero, and its handle is given out again.
+	 * \note A pool is not thread safe, maps sharing a pool must be used from one thread at a time.
+	 */
+	class string_pool {
+		protected:
+			/**
+			 * \brief One string of the pool.
+			 */
+			struct entry {
+				std::string text;     ///< \c text is the string.
+				uint32_t    refs = 0; ///< \c refs is how many times the handle is held.
+			};
+			
+			std::deque<entry>                              entries; ///< \c entries is every string by handle, a deque so that \c text never moves.
+			std::vector<uint32_t>                          unused;  ///< \c unused is the handles of freed strings.
+			std::unordered_map<std::string_view, uint32_t> index;   ///< \c index finds the handle of a string.
+		public:
+			uint32_t         intern(std::string_view);
+			void             retain(uint32_t);
+			void             release(uint32_t);
+			std::string_view text(uint32_t) const;
+			std::size_t      size() const;
+	};
+	
+	/**
+	 * \brief This finds or adds a string and holds its handle once more.
+	 * 
+	 * \param [in] value is the string.
+	 * \return Returns the handle, the caller must \c release it once.
+	 */
+	inline uint32_t string_pool::intern(std::string_view value) {
+		auto found = index.find(value);
+		if (found != index.end()) {
+			entries[(*found).second].refs++;
+			return (*found).second;
+		}
+		uint32_t handle;
+		if (!unused.empty()) {
+			handle = unused.back();
+			unused.pop_back();
+		} else {
+			handle = (uint32_t)entries.size();
+			entries.emplace_back();
+		}
+		entries[handle].text = std::string(value);
+		entries[handle].refs = 1;
+		index.emplace(std::string_view(entries[handle].text), handle);
+		return handle;
+	}
+	
+	/**
+	 * \brief This holds a handle once more.
+	 * 
+	 * \param [in] handle is the handle.
+	 * \return Returns \c void.
+	 */
+	inline void string_pool::retain(uint32_t handle) {
+		entries[handle].refs++;
+	}
+	
+	/**
+	 * \brief This lets go of a handle once, freeing its string if nothing else holds it.
+	 * 
+	 * \param [in] handle is the handle.
+	 * \return Returns \c void.
+	 */
+	inline void string_pool::release(uint32_t handle) {
+		if (--entries[handle].refs == 0) {
+			index.erase(std::string_view(entries[handle].text));
+			entries[handle].text = std::string();
+			unused.push_back(handle);
+		}
+	}
+	
+	/**
+	 * \brief This gives the string of a handle.
+	 * 
+	 * \param [in] handle is the handle.
+	 * \return Returns the string, it stays valid while the handle is held.
+	 */
+	inline std::string_view string_pool::text(uint32_t handle) const {
+		return std::string_view(entries[handle].text);
+	}
+	
+	/**
+	 * \brief This counts the distinct strings in the pool.
+	 * 
+	 * \return Returns the number of strings.
+	 */
+	inline std::size_t string_pool::size() const {
+		return entries.size() - unused.size();
+	}
+	
+	/**
+	 * \brief The interning version of \ref map "extended::map<A, std::string>" for values that repeat a small set of strings.
+	 * 
+	 * \details Each distinct value is kept once in a \ref string_pool "extended::string_pool", which several maps may share, and each entry only stores a 4 byte handle. Reads give a \c std::string_view into the pool, and checking for the \c default_value is a compare of handles.
+	 * \note A view from \c operator>> is valid until the entry is changed or erased.
+	 */
+	template <class A>
+	class interned_map {
+		protected:
+			std::string                  default_value = null<std::string>::value; ///< \c default_value is what stores the values to be ignored, this CANNOT be changed after the constructor to prevent data loss.
+			std::shared_ptr<string_pool> strings;                                   ///< \c strings is the pool the values are kept in.
+			uint32_t                     default_handle;                            ///< \c default_handle is the handle of \c default_value, the map holds it once itself.
+			std::map<A, uint32_t>        data;                                      ///< \c data is the handle of the value of each key.
+		public:
+			interned_map();
+			interned_map(std::string);
+			interned_map(std::string, std::shared_ptr<string_pool>);
+			interned_map(const interned_map&) = delete;
+			interned_map& operator= (const interned_map&) = delete;
+			~interned_map();
+			
+			std::string_view operator>> (A) const;
+			void             operator() (std::pair<A, std::string_view>);
+			void             operator<< (std::pair<A, std::string_view>);
+			void             operator!  ();
+			
+			template <class F>
+			void                         for_each(F) const;
+			std::size_t                  size() const;
+			std::shared_ptr<string_pool> pool() const;
+	};
+	
+	/**
+	 *  \brief Default constructor
+	 *  
+	 *  \details This default constructor uses the \ref null "extended::null<std::string>" \c default_value and a pool of its own.
+	 */
+	template <class A>
+	interned_map<A>::interned_map() : interned_map(null<std::string>::value) {}
+	
+	/**
+	 *  \brief Constructor.
+	 * 
+	 *  \param [in] default_val is the \c default_value for this \c extended::interned_map<A>.
+	 * 
+	 *  \details This constructor uses a pool of its own.
+	 */
+	template <class A>
+	interned_map<A>::interned_map(std::string default_val) : interned_map(default_val, std::make_shared<string_pool>()) {}
+	
+	/**
+	 *  \brief Constructor.
+	 * 
+	 *  \param [in] default_val is the \c default_value for this \c extended::interned_map<A>.
+	 *  \param [in] shared is the pool to keep the values in, it may be shared with other maps.
+	 */
+	template <class A>
+	interned_map<A>::interned_map(std::string default_val, std::shared_ptr<string_pool> shared) : strings(shared) {
+		default_value  = default_val;
+		default_handle = (*strings).intern(default_value);
+	}
+	
+	/**
+	 *  \brief Destructor.
+	 *  
+	 *  \details This lets go of the handle of every entry.
+	 */
+	template <class A>
+	interned_map<A>::~interned_map() {
+		for (auto& entry : data) {
+			(*strings).release(entry.second);
+		}
+		(*strings).release(default_handle);
+	}
+	
+	/**
+	 * \brief This is \c extended::map<A, std::string>::operator>> without a copy of the string.
+	 * 
+	 * \param [in] input is the location of the desired value.
+	 * \return Returns a view of the value of the location if it exists, however, if it does not exist, it will return a view of the \c default_value.
+	 */
+	template <class A>
+	std::string_view interned_map<A>::operator>> (A input) const {
+		auto it = data.find(input);
+		return (*strings).text((it != data.end()) ? (*it).second : default_handle);
+	}
+	
+	/**
+	 * \brief This adds a pair to the map if and only if the first value is already in use or the second value is not the default_value.
+	 * 
+	 * \param [in] input is the pair of the location and the desired value.
+	 * \return Returns \c void.
+	 */
+	template <class A>
+	void interned_map<A>::operator() (std::pair<A, std::string_view> input) {
+		auto it    = data.lower_bound(input.first);
+		bool found = (it != data.end()) && !data.key_comp()(input.first, (*it).first);
+		if (!found && (input.second == std::string_view(default_value))) {
+			return;
+		}
+		uint32_t handle = (*strings).intern(input.second);
+		if (found) {
+			(*strings).release((*it).second);
+			(*it).second = handle;
+		} else {
+			data.emplace_hint(it, input.first, handle);
+		}
+	}
+	
+	/**
+	 * \brief This adds a pair to the map, a \c default_value erases the location.
+	 * 
+	 * \param [in] input is the pair of the location and the desired value.
+	 * \return Returns \c void.
+	 */
+	template <class A>
+	void interned_map<A>::operator<< (std::pair<A, std::string_view> input) {
+		auto it    = data.lower_bound(input.first);
+		bool found = (it != data.end()) && !data.key_comp()(input.first, (*it).first);
+		if (input.second == std::string_view(default_value)) {
+			if (found) {
+				(*strings).release((*it).second);
+				data.erase(it);
+			}
+			return;
+		}
+		uint32_t handle = (*strings).intern(input.second);
+		if (found) {
+			(*strings).release((*it).second);
+			(*it).second = handle;
+		} else {
+			data.emplace_hint(it, input.first, handle);
+		}
+	}
+	
+	/**
+	 * \brief This removes any \c default_value from the map by erasing the entry, comparing handles only.
+	 * 
+	 * \return Returns \c void.
+	 */
+	template <class A>
+	void interned_map<A>::operator! () {
+		for (auto it = data.begin(); it != data.end(); ) {
+			if ((*it).second == default_handle) {
+				(*strings).release((*it).second);
+				it = data.erase(it);
+			} else {
+				std::advance(it, 1);
+			}
+		}
+	}
+	
+	/**
+	 * \brief This calls a function on every entry in key order.
+	 * 
+	 * \param [in] f is called as \c f(key, value) with the value as a \c std::string_view into the pool.
+	 * \return Returns \c void.
+	 */
+	template <class A>
+	template <class F>
+	void interned_map<A>::for_each(F f) const {
+		for (auto& entry : data) {
+			f(entry.first, (*strings).text(entry.second));
+		}
+	}
+	
+	/**
+	 * \brief This counts the entries.
+	 * 
+	 * \return Returns the number of entries.
+	 */
+	template <class A>
+	std::size_t interned_map<A>::size() const {
+		return data.size();
+	}
+	
+	/**
+	 * \brief This gives the pool the values are kept in, to share it with another map.
+	 * 
+	 * \return Returns the pool.
+	 */
+	template <class A>
+	std::shared_ptr<string_pool> interned_map<A>::pool() const {
+		return strings;
+	}
+	
+	/**
+	 * \brief A hash consed pool of values, each kept once, known by a 4 byte handle and counted by how many entries use it.
+	 * 
+	 * \details This is \ref string_pool "extended::string_pool" for any hashable \c B. Interning a value that is already in the pool only adds to its count and does not allocate. A value is destroyed once its count drops to zero, and its handle is given out again.
+	 * \note A pool is not thread safe, maps sharing a pool must be used from one thread at a time.
+	 */
+	template <class B, class Hash = std::hash<B>>
+	class value_pool {
+		protected:
+			/**
+			 * \brief One value of the pool.
+			 */
+			struct entry {
+				std::optional<B> value;    ///< \c value is the value, empty once freed.
+				uint32_t         refs = 0; ///< \c refs is how many times the handle is held.
+			};
+			
+			/**
+			 * \brief Hashes a value through its address.
+			 */
+			struct hash_at {
+				std::size_t operator() (const B* value) const { return Hash()(*value); }
+			};
+			
+			/**
+			 * \brief Compares two values through their addresses.
+			 */
+			struct equal_at {
+				bool operator() (const B* a, const B* b) const { return *a == *b; }
+			};
+			
+			std::deque<entry>                                          entries; ///< \c entries is every value by handle, a deque so that \c value never moves.
+			std::vector<uint32_t>                                      unused;  ///< \c unused is the handles of freed values.
+			std::unordered_map<const B*, uint32_t, hash_at, equal_at> index;   ///< \c index finds the handle of a value.
+		public:
+			uint32_t    intern(const B&);
+			void        retain(uint32_t);
+			void        release(uint32_t);
+			const B&    value(uint32_t) const;
+			std::size_t size() const;
+	};
+	
+	/**
+	 * \brief This finds or adds a value and holds its handle once more.
+	 * 
+	 * \param [in] input is the value.
+	 * \return Returns the handle, the caller must \c release it once.
+	 */
+	template <class B, class Hash>
+	uint32_t value_pool<B, Hash>::intern(const B& input) {
+		auto found = index.find(&input);
+		if (found != index.end()) {
+			entries[(*found).second].refs++;
+			return (*found).second;
+		}
+		uint32_t handle;
+		if (!unused.empty()) {
+			handle = unused.back();
+			unused.pop_back();
+		} else {
+			handle = (uint32_t)entries.size();
+			entries.emplace_back();
+		}
+		entries[handle].value.emplace(input);
+		entries[handle].refs = 1;
+		index.emplace(&*entries[handle].value, handle);
+		return handle;
+	}
+	
+	/**
+	 * \brief This holds a handle once more.
+	 * 
+	 * \param [in] handle is the handle.
+	 * \return Returns \c void.
+	 */
+	template <class B, class Hash>
+	void value_pool<B, Hash>::retain(uint32_t handle) {
+		entries[handle].refs++;
+	}
+	
+	/**
+	 * \brief This lets go of a handle once, destroying its value if nothing else holds it.
+	 * 
+	 * \param [in] handle is the handle.
+	 * \return Returns \c void.
+	 */
+	template <class B, class Hash>
+	void value_pool<B, Hash>::release(uint32_t handle) {
+		if (--entries[handle].refs == 0) {
+			index.erase(&*entries[handle].value);
+			entries[handle].value.reset();
+			unused.push_back(handle);
+		}
+	}
+	
+	/**
+	 * \brief This gives the value of a handle.
+	 * 
+	 * \param [in] handle is the handle.
+	 * \return Returns the value, it stays valid while the handle is held.
+	 */
+	template <class B, class Hash>
+	const B& value_pool<B, Hash>::value(uint32_t handle) const {
+		return *entries[handle].value;
+	}
+	
+	/**
+	 * \brief This counts the distinct values in the pool.
+	 * 
+	 * \return Returns the number of values.
+	 */
+	template <class B, class Hash>
+	std::size_t value_pool<B, Hash>::size() const {
+		return entries.size() - unused.size();
+	}
+	
+	/**
+	 * \brief The deduplicating version of \ref map "extended::map<A, B>" for large values that repeat across keys.
+	 * 
+	 * \details Each distinct value is kept once in a \ref value_pool "extended::value_pool", which several maps may share, and each entry only stores a 4 byte handle. Memory shrinks by about the duplication factor, \c operator<< with a value already in the pool does not allocate for it, and checking for the \c default_value is a compare of handles.
+	 * \note \c B needs \c operator== and a \c Hash. A reference from \c operator>> is valid until the entry is changed or erased.
+	 */
+	template <class A, class B, class Hash = std::hash<B>>
+	class dedup_map {
+		protected:
+			B                                    default_value = null<B>::value; ///< \c default_value is what stores the values to be ignored, this CANNOT be changed after the constructor to prevent data loss.
+			std::shared_ptr<value_pool<B, Hash>> values;                          ///< \c values is the pool the values are kept in.
+			uint32_t                             default_handle;                  ///< \c default_handle is the handle of \c default_value, the map holds it once itself.
+			std::map<A, uint32_t>                data;                            ///< \c data is the handle of the value of each key.
+		public:
+			dedup_map();
+			dedup_map(B);
+			dedup_map(B, std::shared_ptr<value_pool<B, Hash>>);
+			dedup_map(const dedup_map&) = delete;
+			dedup_map& operator= (const dedup_map&) = delete;
+			~dedup_map();
+			
+			const B& operator>> (A) const;
+			void     operator() (std::pair<A, B>);
+			void     operator<< (std::pair<A, B>);
+			void     operator!  ();
+			
+			template <class F>
+			void                                 for_each(F) const;
+			std::size_t                          size() const;
+			std::shared_ptr<value_pool<B, Hash>> pool() const;
+	};
+	
+	/**
+	 *  \brief Default constructor
+	 *  
+	 *  \details This default constructor uses the \ref null "extended::null<B>" \c default_value and a pool of its own.
+	 */
+	template <class A, class B, class Hash>
+	dedup_map<A, B, Hash>::dedup_map() : dedup_map(null<B>::value) {}
+	
+	/**
+	 *  \brief Constructor.
+	 * 
+	 *  \param [in] default_val is the \c default_value for this \c extended::dedup_map<A, B>.
+	 * 
+	 *  \details This constructor uses a pool of its own.
+	 */
+	template <class A, class B, class Hash>
+	dedup_map<A, B, Hash>::dedup_map(B default_val) : dedup_map(default_val, std::make_shared<value_pool<B, Hash>>()) {}
+	
+	/**
+	 *  \brief Constructor.
+	 * 
+	 *  \param [in] default_val is the \c default_value for this \c extended::dedup_map<A, B>.
+	 *  \param [in] shared is the pool to keep the values in, it may be shared with other maps.
+	 */
+	template <class A, class B, class Hash>
+	dedup_map<A, B, Hash>::dedup_map(B default_val, std::shared_ptr<value_pool<B, Hash>> shared) : values(shared) {
+		default_value  = default_val;
+		default_handle = (*values).intern(default_value);
+	}
+	
+	/**
+	 *  \brief Destructor.
+	 *  
+	 *  \details This lets go of the handle of every entry.
+	 */
+	template <class A, class B, class Hash>
+	dedup_map<A, B, Hash>::~dedup_map() {
+		for (auto& entry : data) {
+			(*values).release(entry.second);
+		}
+		(*values).release(default_handle);
+	}
+	
+	/**
+	 * \brief This is \c extended::map<A, B>::operator>> without a copy of the value.
+	 * 
+	 * \param [in] input is the location of the desired value.
+	 * \return Returns the value of the location if it exists, however, if it does not exist, it will return the \c default_value.
+	 */
+	template <class A, class B, class Hash>
+	const B& dedup_map<A, B, Hash>::operator>> (A input) const {
+		auto it = data.find(input);
+		return (*values).value((it != data.end()) ? (*it).second : default_handle);
+	}
+	
+	/**
+	 * \brief This adds a pair to the map if and only if the first value is already in use or the second value is not the default_value.
+	 * 
+	 * \param [in] input is the pair of the location and the desired value.
+	 * \return Returns \c void.
+	 */
+	template <class A, class B, class Hash>
+	void dedup_map<A, B, Hash>::operator() (std::pair<A, B> input) {
+		auto it    = data.lower_bound(input.first);
+		bool found = (it != data.end()) && !data.key_comp()(input.first, (*it).first);
+		if (!found && (input.second == default_value)) {
+			return;
+		}
+		uint32_t handle = (*values).intern(input.second);
+		if (found) {
+			(*values).release((*it).second);
+			(*it).second = handle;
+		} else {
+			data.emplace_hint(it, input.first, handle);
+		}
+	}
+	
+	/**
+	 * \brief This adds a pair to the map, a \c default_value erases the location.
+	 * 
+	 * \param [in] input is the pair of the location and the desired value.
+	 * \return Returns \c void.
+	 */
+	template <class A, class B, class Hash>
+	void dedup_map<A, B, Hash>::operator<< (std::pair<A, B> input) {
+		auto it    = data.lower_bound(input.first);
+		bool found = (it != data.end()) && !data.key_comp()(input.first, (*it).first);
+		if (input.second == default_value) {
+			if (found) {
+				(*values).release((*it).second);
+				data.erase(it);
+			}
+			return;
+		}
+		uint32_t handle = (*values).intern(input.second);
+		if (found) {
+			(*values).release((*it).second);
+			(*it).second = handle;
+		} else {
+			data.emplace_hint(it, input.first, handle);
+		}
+	}
+	
+	/**
+	 * \brief This removes any \c default_value from the map by erasing the entry, comparing handles only.
+	 * 
+	 * \return Returns \c void.
+	 */
+	template <class A, class B, class Hash>
+	void dedup_map<A, B, Hash>::operator! () {
+		for (auto it = data.begin(); it != data.end(); ) {
+			if ((*it).second == default_handle) {
+				(*values).release((*it).second);
+				it = data.erase(it);
+			} else {
+				std::advance(it, 1);
+			}
+		}
+	}
+	
+	/**
+	 * \brief This calls a function on every entry in key order.
+	 * 
+	 * \param [in] f is called as \c f(key, value) with the value as a \c const \c B& into the pool.
+	 * \return Returns \c void.
+	 */
+	template <class A, class B, class Hash>
+	template <class F>
+	void dedup_map<A, B, Hash>::for_each(F f) const {
+		for (auto& entry : data) {
+			f(entry.first, (*values).value(entry.second));
+		}
+	}
+	
+	/**
+	 * \brief This counts the entries.
+	 * 
+	 * \return Returns the number of entries.
+	 */
+	template <class A, class B, class Hash>
+	std::size_t dedup_map<A, B, Hash>::size() const {
+		return data.size();
+	}
+	
+	/**
+	 * \brief This gives the pool the values are kept in, to share it with another map.
+	 * 
+	 * \return Returns the pool.
+	 */
+	template <class A, class B, class Hash>
+	std::shared_ptr<value_pool<B, Hash>> dedup_map<A, B, Hash>::pool() const {
+		return values;
+	}
+	
+	/**
+	 * \brief The out of line version of \ref map "extended::map<A, B>" for large values, which keeps only keys in the tree.
+	 * 
+	 * \details Each tree node holds a key and a 4 byte slot, and the values sit in one contiguous slab addressed by slot. A descent then only touches small, cache dense nodes, and the slots of erased entries are given out again before the slab grows.
+	 * \note A reference from \c operator>> is valid until the next call that adds an entry, since the slab may grow.
+	 */
+	template <class A, class B>
+	class slab_map {
+		protected:
+			B                     default_value = null<B>::value; ///< \c default_value is what stores the values to be ignored, this CANNOT be changed after the constructor to prevent data loss.
+			std::map<A, uint32_t> data;                           ///< \c data is the slot of the value of each key.
+			std::vector<B>        values;                         ///< \c values is the slab of values by slot.
+			std::vector<uint32_t> unused;                         ///< \c unused is the slots of erased entries.
+			
+			uint32_t place(const B&);
+			void     free(uint32_t);
+		public:
+			slab_map();
+			slab_map(B);
+			
+			const B& operator>> (A) const;
+			void     operator() (std::pair<A, B>);
+			void     operator<< (std::pair<A, B>);
+			void     operator!  ();
+			
+			template <class F>
+			void        for_each(F) const;
+			std::size_t size() const;
+			std::size_t slots() const;
+	};
+	
+	/**
+	 *  \brief Default constructor
+	 *  
+	 *  \details This default constructor uses the \ref null "extended::null<B>" \c default_value.
+	 */
+	template <class A, class B>
+	slab_map<A, B>::slab_map() {}
+	
+	/**
+	 *  \brief Constructor.
+	 * 
+	 *  \param [in] default_val is the \c default_value for this \c extended::slab_map<A, B>.
+	 */
+	template <class A, class B>
+	slab_map<A, B>::slab_map(B default_val) {
+		default_value = default_val;
+	}
+	
+	/**
+	 * \brief This puts a value in a free slot, or at the end of the slab.
+	 * 
+	 * \param [in] input is the value.
+	 * \return Returns the slot.
+	 */
+	template <class A, class B>
+	uint32_t slab_map<A, B>::place(const B& input) {
+		if (!unused.empty()) {
+			uint32_t slot = unused.back();
+			unused.pop_back();
+			values[slot] = input;
+			return slot;
+		}
+		values.push_back(input);
+		return (uint32_t)(values.size() - 1);
+	}
+	
+	/**
+	 * \brief This gives a slot back, resetting it to the \c default_value so it holds no resources.
+	 * 
+	 * \param [in] slot is the slot.
+	 * \return Returns \c void.
+	 */
+	template <class A, class B>
+	void slab_map<A, B>::free(uint32_t slot) {
+		values[slot] = default_value;
+		unused.push_back(slot);
+	}
+	
+	/**
+	 * \brief This is \c extended::map<A, B>::operator>> without a copy of the value.
+	 * 
+	 * \param [in] input is the location of the desired value.
+	 * \return Returns the value of the location if it exists, however, if it does not exist, it will return the \c default_value.
+	 */
+	template <class A, class B>
+	const B& slab_map<A, B>::operator>> (A input) const {
+		auto it = data.find(input);
+		return (it != data.end()) ? values[(*it).second] : default_value;
+	}
+	
+	/**
+	 * \brief This adds a pair to the map if and only if the first value is already in use or the second value is not the default_value.
+	 * 
+	 * \param [in] input is the pair of the location and the desired value.
+	 * \return Returns \c void.
+	 */
+	template <class A, class B>
+	void slab_map<A, B>::operator() (std::pair<A, B> input) {
+		auto it    = data.lower_bound(input.first);
+		bool found = (it != data.end()) && !data.key_comp()(input.first, (*it).first);
+		if (found) {
+			values[(*it).second] = std::move(input.second);
+		} else if (!(input.second == default_value)) {
+			data.emplace_hint(it, input.first, place(input.second));
+		}
+	}
+	
+	/**
+	 * \brief This adds a pair to the map, a \c default_value erases the location.
+	 * 
+	 * \param [in] input is the pair of the location and the desired value.
+	 * \return Returns \c void.
+	 */
+	template <class A, class B>
+	void slab_map<A, B>::operator<< (std::pair<A, B> input) {
+		auto it    = data.lower_bound(input.first);
+		bool found = (it != data.end()) && !data.key_comp()(input.first, (*it).first);
+		if (input.second == default_value) {
+			if (found) {
+				free((*it).second);
+				data.erase(it);
+			}
+		} else if (found) {
+			values[(*it).second] = std::move(input.second);
+		} else {
+			data.emplace_hint(it, input.first, place(input.second));
+		}
+	}
+	
+	/**
+	 * \brief This removes any \c default_value from the map by erasing the entry and giving back its slot.
+	 * 
+	 * \return Returns \c void.
+	 */
+	template <class A, class B>
+	void slab_map<A, B>::operator! () {
+		for (auto it = data.begin(); it != data.end(); ) {
+			if (values[(*it).second] == default_value) {
+				free((*it).second);
+				it = data.erase(it);
+			} else {
+				std::advance(it, 1);
+			}
+		}
+	}
+	
+	/**
+	 * \brief This calls a function on every entry in key order.
+	 * 
+	 * \param [in] f is called as \c f(key, value).
+	 * \return Returns \c void.
+	 */
+	template <class A, class B>
+	template <class F>
+	void slab_map<A, B>::for_each(F f) const {
+		for (auto& entry : data) {
+			f(entry.first, values[entry.second]);
+		}
+	}
+	
+	/**
+	 * \brief This counts the entries.
+	 * 
+	 * \return Returns the number of entries.
+	 */
+	template <class A, class B>
+	std::size_t slab_map<A, B>::size() const {
+		return data.size();
+	}
+	
+	/**
+	 * \brief This counts the slots of the slab, used or free.
+	 * 
+	 * \return Returns the number of slots.
+	 */
+	template <class A, class B>
+	std::size_t slab_map<A, B>::slots() const {
+		return values.size();
+	}
+	///@}
+	
+	/**
+	 * \defgroup memory extended::numa and extended::slab
+	 * 
+	 * \brief Where the concurrent maps get their memory from.
+	 * 
+	 * \details \c extended::numa places memory on a NUMA node, \c extended::slab carves small blocks out of large node placed chunks and recycles freed blocks, \c extended::slab_allocator lets a \c std::map use a slab, \c extended::node_allocator lets it use the slab of each thread, and \c extended::arena gives out memory that is only freed all at once.
+	 * \note With \c EXTENDED_NUMA defined libnuma is used and must be linked with \c -lnuma, otherwise on Linux the system calls are made directly, and elsewhere there is only one node.
+	 * @{
+	 */
+	
+	/**
+	 * \brief \c numa finds the NUMA nodes and places memory on them.
+	 */
+	class numa {
+		public:
+			static int   nodes();
+			static int   current();
+			static void* allocate(std::size_t, int, bool = false);
+			static void  release(void*, std::size_t);
+	};
+	
+	/**
+	 * \brief This counts the NUMA nodes.
+	 * 
+	 * \return Returns the number of nodes, it is 1 if the machine is not NUMA or it cannot be told.
+	 */
+	inline int numa::nodes() {
+		static const int count = []() {
+#if defined(EXTENDED_NUMA)
+			return (numa_available() < 0) ? 1 : numa_max_node() + 1;
+#elif defined(__linux__)
+			std::ifstream online("/sys/devices/system/node/online");
+			std::string   text;
+			if (!(online >> text) || text.empty()) {
+				return 1;
+			}
+			std::size_t last = text.find_last_of("-,");
+			return std::atoi(text.c_str() + ((last == std::string::npos) ? 0 : last + 1)) + 1;
+#else
+			return 1;
+#endif
+		}();
+		return count;
+	}
+	
+	/**
+	 * \brief This finds the NUMA node the calling thread is running on.
+	 * 
+	 * \return Returns the node, or 0 if it cannot be told.
+	 */
+	inline int numa::current() {
+#if defined(EXTENDED_NUMA)
+		int cpu = sched_getcpu();
+		return ((cpu < 0) || (numa_available() < 0)) ? 0 : std::max(numa_node_of_cpu(cpu), 0);
+#elif defined(__linux__) && defined(SYS_getcpu)
+		unsigned cpu  = 0;
+		unsigned node = 0;
+		return (syscall(SYS_getcpu, &cpu, &node, nullptr) == 0) ? (int)node : 0;
+#else
+		return 0;
+#endif
+	}
+	
+	/**
+	 * \brief This gets whole pages of memory that prefer a NUMA node.
+	 * 
+	 * \param [in] bytes is the size, it should be a multiple of the page size.
+	 * \param [in] node is the node, or -1 for no preference.
+	 * \param [in] huge asks for huge pages, \c bytes should then be a multiple of 2 MB.
+	 * \return Returns the memory, it must be given back with \c release.
+	 * 
+	 * \details The node is only a preference, if it has no free memory the pages come from another node rather than failing. Huge pages are taken from the reserved huge page pool if there are any, otherwise the kernel is asked to back the memory with transparent huge pages, and if neither works normal pages are used.
+	 * \note Where there are no pages to map the memory comes from \c operator \c new aligned to 64 bytes, so that the cache line aligned shards placed in it stay aligned. \c mbind is given one bit more than the mask holds, since the kernel reads one bit fewer than it is told.
+	 */
+	inline void* numa::allocate(std::size_t bytes, int node, bool huge) {
+#if defined(EXTENDED_NUMA)
+		if ((node >= 0) && (numa_available() >= 0)) {
+			void* out = numa_alloc_onnode(bytes, node);
+			if (out == nullptr) {
+				throw std::bad_alloc();
+			}
+#if defined(MADV_HUGEPAGE)
+			if (huge) {
+				madvise(out, bytes, MADV_HUGEPAGE);
+			}
+#endif
+			return out;
+		}
+#endif
+#if defined(__linux__)
+		void* out = MAP_FAILED;
+#if defined(MAP_HUGETLB)
+		if (huge) {
+			out = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		}
+#endif
+		if (out == MAP_FAILED) {
+			out = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			if (out == MAP_FAILED) {
+				throw std::bad_alloc();
+			}
+#if defined(MADV_HUGEPAGE)
+			if (huge) {
+				madvise(out, bytes, MADV_HUGEPAGE);
+			}
+#endif
+		}
+#if !defined(EXTENDED_NUMA) && defined(SYS_mbind)
+		if ((node >= 0) && (node < 64) && (nodes() > 1)) {
+			unsigned long mask = 1UL << node;
+			syscall(SYS_mbind, out, bytes, 1, &mask, sizeof(mask) * 8 + 1, 0);
+		}
+#endif
+		return out;
+#else
+		(void)node;
+		(void)huge;
+		return ::operator new(bytes, std::align_val_t{64});
+#endif
+	}
+	
+	/**
+	 * \brief This gives back memory from \c allocate.
+	 * 
+	 * \param [in] memory is the memory.
+	 * \param [in] bytes is the size that was asked for.
+	 * \return Returns \c void.
+	 */
+	inline void numa::release(void* memory, std::size_t bytes) {
+#if defined(EXTENDED_NUMA)
+		if (numa_available() >= 0) {
+			numa_free(memory, bytes);
+			return;
+		}
+#endif
+#if defined(__linux__)
+		munmap(memory, bytes);
+#else
+		(void)bytes;
+		::operator delete(memory, std::align_val_t{64});
+#endif
+	}
+	
+	/**
+	 * \brief A pool of small blocks carved from large chunks placed on one NUMA node.
+	 * 
+	 * \details Blocks are sized in steps of 16 bytes up to 256 bytes, and a freed block goes on a free list for its size to be given out again. Larger blocks come from \c operator \c new. Chunks are 256 KB, or 2 MB backed by huge pages if asked for.
+	 * \note A slab is not thread safe, the concurrent maps only use it under the lock of its shard, and \c local gives each thread its own.
+	 */
+	class slab {
+		protected:
+			static const std::size_t chunk_size = 1 << 18; ///< \c chunk_size is the size of each chunk.
+			static const std::size_t huge_size  = 1 << 21; ///< \c huge_size is the size of each chunk backed by huge pages.
+			static const std::size_t step       = 16;      ///< \c step is the size difference between block sizes.
+			static const std::size_t largest    = 256;     ///< \c largest is the largest block a slab gives out.
+			
+			int                node   = -1;                  ///< \c node is the NUMA node the chunks prefer, or -1.
+			bool               huge   = false;               ///< \c huge is \c true if the chunks are backed by huge pages.
+			std::vector<void*> chunks;                       ///< \c chunks is every chunk.
+			char*              cursor = nullptr;             ///< \c cursor is the start of the unused part of the last chunk.
+			char*              limit  = nullptr;             ///< \c limit is the end of the last chunk.
+			void*              free_lists[largest / step] = {}; ///< \c free_lists is the freed blocks of each size, linked through their first word.
+			
+			static std::atomic<bool>& huge_default();
+		public:
+			slab(int = -1, bool = false);
+			slab(const slab&) = delete;
+			slab& operator= (const slab&) = delete;
+			~slab();
+			
+			static slab& local();
+			static void  use_huge_pages(bool = true);
+			
+			void* allocate(std::size_t);
+			void  deallocate(void*, std::size_t);
+			int   home() const;
+	};
+	
+	/**
+	 *  \brief Constructor.
+	 * 
+	 *  \param [in] where is the NUMA node the chunks should be placed on, or -1 for no preference.
+	 *  \param [in] large is \c true to back the chunks with huge pages.
+	 */
+	inline slab::slab(int where, bool large) : node(where), huge(large) {}
+	
+	/**
+	 *  \brief Destructor.
+	 *  
+	 *  \details This gives back every chunk, every block must already be unused.
+	 */
+	inline slab::~slab() {
+		for (void* chunk : chunks) {
+			numa::release(chunk, huge ? huge_size : chunk_size);
+		}
+	}
+	
+	/**
+	 * \brief This holds whether the slabs made by \c local use huge pages.
+	 * 
+	 * \return Returns the setting.
+	 */
+	inline std::atomic<bool>& slab::huge_default() {
+		static std::atomic<bool> on{false};
+		return on;
+	}
+	
+	/**
+	 * \brief This sets whether the slabs \c local makes from now on are backed by huge pages.
+	 * 
+	 * \param [in] on is \c true to use huge pages.
+	 * \return Returns \c void.
+	 * 
+	 * \note Call this before the threads that use \c node_allocator start, a thread keeps the slab it was first given.
+	 */
+	inline void slab::use_huge_pages(bool on) {
+		huge_default().store(on, std::memory_order_relaxed);
+	}
+	
+	/**
+	 * \brief This gets the slab of the calling thread, making it the first time, on the NUMA node the thread is running on.
+	 * 
+	 * \return Returns the slab.
+	 * 
+	 * \details A block freed on another thread goes on the free lists of that thread, so blocks move to where they are freed. The slabs are never destroyed since blocks from them may still be in use when their thread ends, instead the slab of a thread that ends is kept and given to the next new thread.
+	 */
+	inline slab& slab::local() {
+		static std::mutex*          spare_lock = new std::mutex();
+		static std::vector<slab*>*  spare      = new std::vector<slab*>();
+		struct owner {
+			slab* mine;
+			owner() {
+				std::lock_guard<std::mutex> hold(*spare_lock);
+				if ((*spare).empty()) {
+					mine = new slab(numa::current(), huge_default().load(std::memory_order_relaxed));
+				} else {
+					mine = (*spare).back();
+					(*spare).pop_back();
+				}
+			}
+			~owner() {
+				std::lock_guard<std::mutex> hold(*spare_lock);
+				(*spare).push_back(mine);
+			}
+		};
+		static thread_local owner held;
+		return *held.mine;
+	}
+	
+	/**
+	 * \brief This gives out a block.
+	 * 
+	 * \param [in] bytes is the size of the block.
+	 * \return Returns the block, it is aligned to 16 bytes.
+	 */
+	inline void* slab::allocate(std::size_t bytes) {
+		if (bytes > largest) {
+			return ::operator new(bytes);
+		}
+		std::size_t size = (bytes == 0) ? step : (bytes + step - 1) / step * step;
+		void*&      head = free_lists[size / step - 1];
+		if (head != nullptr) {
+			void* out = head;
+			head = *(void**)out;
+			return out;
+		}
+		if ((std::size_t)(limit - cursor) < size) {
+			std::size_t bytes = huge ? huge_size : chunk_size;
+			chunks.push_back(numa::allocate(bytes, node, huge));
+			cursor = (char*)chunks.back();
+			limit  = cursor + bytes;
+		}
+		void* out = cursor;
+		cursor += size;
+		return out;
+	}
+	
+	/**
+	 * \brief This takes back a block.
+	 * 
+	 * \param [in] block is the block.
+	 * \param [in] bytes is the size that was asked for.
+	 * \return Returns \c void.
+	 */
+	inline void slab::deallocate(void* block, std::size_t bytes) {
+		if (bytes > largest) {
+			::operator delete(block);
+			return;
+		}
+		std::size_t size = (bytes == 0) ? step : (bytes + step - 1) / step * step;
+		*(void**)block = free_lists[size / step - 1];
+		free_lists[size / step - 1] = block;
+	}
+	
+	/**
+	 * \brief This gets the NUMA node of the slab.
+	 * 
+	 * \return Returns the node, or -1 for no preference.
+	 */
+	inline int slab::home() const {
+		return node;
+	}
+	
+	/**
+	 * \brief \c slab_allocator\<T\> lets a standard container get its memory from a \ref slab "extended::slab".
+	 * 
+	 * \details Every copy and rebind of the allocator uses the same slab, the slab must outlive the container.
+	 */
+	template <class T>
+	class slab_allocator {
+		template <class U> friend class slab_allocator;
+		protected:
+			slab* pool; ///< \c pool is the slab memory comes from.
+		public:
+			using value_type = T; ///< \c value_type is the type that is allocated.
+			
+			slab_allocator(slab*);
+			template<class U> slab_allocator(const slab_allocator<U>&);
+			
+			T*   allocate(std::size_t);
+			void deallocate(T*, std::size_t);
+			
+			template<class U> bool operator== (const slab_allocator<U>&) const;
+			template<class U> bool operator!= (const slab_allocator<U>&) const;
+	};
+	
+	/**
+	 *  \brief Constructor.
+	 * 
+	 *  \param [in] from is the slab memory comes from.
+	 */
+	template <class T>
+	slab_allocator<T>::slab_allocator(slab* from) : pool(from) {}
+	
+	/**
+	 *  \brief Rebinding constructor.
+	 * 
+	 *  \param [in] other is the allocator whose slab is used.
+	 */
+	template <class T>
+	template <class U>
+	slab_allocator<T>::slab_allocator(const slab_allocator<U>& other) : pool(other.pool) {}
+	
+	/**
+	 * \brief This gets memory for some objects.
+	 * 
+	 * \param [in] count is the number of objects.
+	 * \return Returns the memory.
+	 */
+	template <class T>
+	T* slab_allocator<T>::allocate(std::size_t count) {
+		if (alignof(T) > 16) {
+			return static_cast<T*>(::operator new(count * sizeof(T), std::align_val_t(alignof(T))));
+		}
+		return static_cast<T*>((*pool).allocate(count * sizeof(T)));
+	}
+	
+	/**
+	 * \brief This gives back memory from \c allocate.
+	 * 
+	 * \param [in] memory is the memory.
+	 * \param [in] count is the number of objects.
+	 * \return Returns \c void.
+	 */
+	template <class T>
+	void slab_allocator<T>::deallocate(T* memory, std::size_t count) {
+		if (alignof(T) > 16) {
+			::operator delete(memory, std::align_val_t(alignof(T)));
+			return;
+		}
+		(*pool).deallocate(memory, count * sizeof(T));
+	}
+	
+	/**
+	 * \brief This checks if two allocators share memory.
+	 * 
+	 * \param [in] other is the other allocator.
+	 * \return Returns \c true if they use the same slab.
+	 */
+	template <class T>
+	template <class U>
+	bool slab_allocator<T>::operator== (const slab_allocator<U>& other) const {
+		return pool == other.pool;
+	}
+	
+	/**
+	 * \brief This checks if two allocators do not share memory.
+	 * 
+	 * \param [in] other is the other allocator.
+	 * \return Returns \c true if they use different slabs.
+	 */
+	template <class T>
+	template <class U>
+	bool slab_allocator<T>::operator!= (const slab_allocator<U>& other) const {
+		return pool != other.pool;
+	}
+	
+	/**
+	 * \brief \c node_allocator\<T\> gives the nodes of a standard container from the \ref slab "extended::slab" of the calling thread.
+	 * 
+	 * \details Erased nodes go on the free list for their size and the next node of that size reuses them, so a map that keeps setting, erasing and re-adding keys stops calling \c malloc and \c free once it has warmed up. The allocator has no state, every copy is equal and containers using it can be moved and swapped freely.
+	 * \note Over aligned types and blocks larger than 256 bytes come from \c operator \c new.
+	 */
+	template <class T>
+	class node_allocator {
+		public:
+			using value_type                             = T;               ///< \c value_type is the type that is allocated.
+			using is_always_equal                        = std::true_type;  ///< \c is_always_equal is \c true since every copy shares the thread slabs.
+			using propagate_on_container_move_assignment = std::true_type;  ///< \c propagate_on_container_move_assignment lets moved maps keep their nodes.
+			
+			node_allocator() noexcept = default;
+			template<class U> node_allocator(const node_allocator<U>&) noexcept;
+			
+			T*   allocate(std::size_t);
+			void deallocate(T*, std::size_t);
+			
+			template<class U> bool operator== (const node_allocator<U>&) const;
+			template<class U> bool operator!= (const node_allocator<U>&) const;
+	};
+	
+	/**
+	 *  \brief Rebinding constructor.
+	 * 
+	 *  \param [in] other is the allocator being rebound, it has no state.
+	 */
+	template <class T>
+	template <class U>
+	node_allocator<T>::node_allocator(const node_allocator<U>& other) noexcept {
+		(void)other;
+	}
+	
+	/**
+	 * \brief This gets memory for some objects from the slab of the calling thread.
+	 * 
+	 * \param [in] count is the number of objects.
+	 * \return Returns the memory.
+	 */
+	template <class T>
+	T* node_allocator<T>::allocate(std::size_t count) {
+		if (alignof(T) > 16) {
+			return static_cast<T*>(::operator new(count * sizeof(T), std::align_val_t(alignof(T))));
+		}
+		return static_cast<T*>(slab::local().allocate(count * sizeof(T)));
+	}
+	
+	/**
+	 * \brief This gives back memory from \c allocate to the slab of the calling thread.
+	 * 
+	 * \param [in] memory is the memory.
+	 * \param [in] count is the number of objects.
+	 * \return Returns \c void.
+	 */
+	template <class T>
+	void node_allocator<T>::deallocate(T* memory, std::size_t count) {
+		if (alignof(T) > 16) {
+			::operator delete(memory, std::align_val_t(alignof(T)));
+			return;
+		}
+		slab::local().deallocate(memory, count * sizeof(T));
+	}
+	
+	/**
+	 * \brief This checks if two allocators share memory.
+	 * 
+	 * \param [in] other is the other allocator.
+	 * \return Returns \c true, memory from one can always be given back to the other.
+	 */
+	template <class T>
+	template <class U>
+	bool node_allocator<T>::operator== (const node_allocator<U>& other) const {
+		(void)other;
+		return true;
+	}
+	
+	/**
+	 * \brief This checks if two allocators do not share memory.
+	 * 
+	 * \param [in] other is the other allocator.
+	 * \return Returns \c false, memory from one can always be given back to the other.
+	 */
+	template <class T>
+	template <class U>
+	bool node_allocator<T>::operator!= (const node_allocator<U>& other) const {
+		(void)other;
+		return false;
+	}
+	
+	namespace pooled {
+		/**
+		 * \brief \ref map "extended::map<A, B>" with its nodes recycled through \ref node_allocator "extended::node_allocator".
+		 * 
+		 * \details This suits maps whose keys are often erased by \c operator<< with the \c default_value and then added again. Call \c extended::slab::use_huge_pages first to back the slabs with huge pages.
+		 */
+		template <class A, class B>
+		using map = extended::map<A, B, node_allocator<std::pair<const A, B>>>;
+	}
+	
+	/**
+	 * \brief A bump allocator that gives out memory from large blocks and only frees it all at once.
+	 * 
+	 * \details Each block is twice the size of the one before it, so a region of any size takes few blocks. Freeing one allocation does nothing, \c release frees every block but the last and starts again at its beginning.
+	 * \note An arena is not thread safe.
+	 */
+	class arena {
+		protected:
+			/**
+			 * \brief The header at the start of every block.
+			 */
+			struct block {
+				block*      next; ///< \c next is the block made before this one.
+				std::size_t size; ///< \c size is the size of the block, including this header.
+			};
+			
+			static const std::size_t first_size = 1 << 16; ///< \c first_size is the size of the first block.
+			
+			block* blocks = nullptr; ///< \c blocks is the newest block, the rest are linked from it.
+			char*  cursor = nullptr; ///< \c cursor is the start of the unused part of the newest block.
+			char*  limit  = nullptr; ///< \c limit is the end of the newest block.
+		public:
+			arena() = default;
+			arena(const arena&) = delete;
+			arena& operator= (const arena&) = delete;
+			~arena();
+			
+			void*       allocate(std::size_t, std::size_t);
+			void        release();
+			std::size_t footprint() const;
+	};
+	
+	/**
+	 *  \brief Destructor.
+	 *  
+	 *  \details This frees every block.
+	 */
+	inline arena::~arena() {
+		while (blocks != nullptr) {
+			block* next = (*blocks).next;
+			::operator delete(blocks);
+			blocks = next;
+		}
+	}
+	
+	/**
+	 * \brief This gives out memory from the newest block, making a larger block if it does not fit.
+	 * 
+	 * \param [in] bytes is the size of the memory.
+	 * \param [in] align is the alignment of the memory, it must be a power of two.
+	 * \return Returns the memory.
+	 */
+	inline void* arena::allocate(std::size_t bytes, std::size_t align) {
+		uintptr_t start = ((uintptr_t)cursor + align - 1) & ~(uintptr_t)(align - 1);
+		if ((blocks == nullptr) || (start + bytes > (uintptr_t)limit)) {
+			std::size_t size = (blocks == nullptr) ? first_size : (*blocks).size * 2;
+			while (size < sizeof(block) + bytes + align) {
+				size *= 2;
+			}
+			block* fresh = static_cast<block*>(::operator new(size));
+			(*fresh).next = blocks;
+			(*fresh).size = size;
+			blocks = fresh;
+			cursor = (char*)fresh + sizeof(block);
+			limit  = (char*)fresh + size;
+			start  = ((uintptr_t)cursor + align - 1) & ~(uintptr_t)(align - 1);
+		}
+		cursor = (char*)(start + bytes);
+		return (void*)start;
+	}
+	
+	/**
+	 * \brief This frees everything given out, keeping the newest block to be used again.
+	 * 
+	 * \return Returns \c void.
+	 * 
+	 * \details Only the blocks are freed, not the allocations in them, so the time taken does not depend on how much was given out.
+	 */
+	inline void arena::release() {
+		if (blocks == nullptr) {
+			return;
+		}
+		block* next = (*blocks).next;
+		while (next != nullptr) {
+			block* after = (*next).next;
+			::operator delete(next);
+			next = after;
+		}
+		(*blocks).next = nullptr;
+		cursor = (char*)blocks + sizeof(block);
+	}
+	
+	/**
+	 * \brief This counts the memory the arena holds.
+	 * 
+	 * \return Returns the total size of the blocks in bytes.
+	 */
+	inline std::size_t arena::footprint() const {
+		std::size_t total = 0;
+		for (block* it = blocks; it != nullptr; it = (*it).next) {
+			total += (*it).size;
+		}
+		return total;
+	}
+	
+	/**
+	 * \brief \c arena_allocator\<T\> lets a standard container get its memory from an \ref arena "extended::arena".
+	 * 
+	 * \details Every copy and rebind of the allocator uses the same arena, the arena must outlive the container. \c deallocate does nothing, the memory is only given back by \c arena::release.
+	 */
+	template <class T>
+	class arena_allocator {
+		template <class U> friend class arena_allocator;
+		protected:
+			arena* region; ///< \c region is the arena memory comes from.
+		public:
+			using value_type = T; ///< \c value_type is the type that is allocated.
+			
+			arena_allocator(arena*);
+			template<class U> arena_allocator(const arena_allocator<U>&);
+			
+			T*   allocate(std::size_t);
+			void deallocate(T*, std::size_t);
+			
+			template<class U> bool operator== (const arena_allocator<U>&) const;
+			template<class U> bool operator!= (const arena_allocator<U>&) const;
+	};
+	
+	/**
+	 *  \brief Constructor.
+	 * 
+	 *  \param [in] from is the arena memory comes from.
+	 */
+	template <class T>
+	arena_allocator<T>::arena_allocator(arena* from) : region(from) {}
+	
+	/**
+	 *  \brief Rebinding constructor.
+	 * 
+	 *  \param [in] other is the allocator whose arena is used.
+	 */
+	template <class T>
+	template <class U>
+	arena_allocator<T>::arena_allocator(const arena_allocator<U>& other) : region(other.region) {}
+	
+	/**
+	 * \brief This gets memory for some objects.
+	 * 
+	 * \param [in] count is the number of objects.
+	 * \return Returns the memory.
+	 */
+	template <class T>
+	T* arena_allocator<T>::allocate(std::size_t count) {
+		return static_cast<T*>((*region).allocate(count * sizeof(T), alignof(T)));
+	}
+	
+	/**
+	 * \brief This does nothing, the memory is given back when the arena is released.
+	 * 
+	 * \param [in] memory is the memory.
+	 * \param [in] count is the number of objects.
+	 * \return Returns \c void.
+	 */
+	template <class T>
+	void arena_allocator<T>::deallocate(T* memory, std::size_t count) {
+		(void)memory;
+		(void)count;
+	}
+	
+	/**
+	 * \brief This checks if two allocators share memory.
+	 * 
+	 * \param [in] other is the other allocator.
+	 * \return Returns \c true if they use the same arena.
+	 */
+	template <class T>
+	template <class U>
+	bool arena_allocator<T>::operator== (const arena_allocator<U>& other) const {
+		return region == other.region;
+	}
+	
+	/**
+	 * \brief This checks if two allocators do not share memory.
+	 * 
+	 * \param [in] other is the other allocator.
+	 * \return Returns \c true if they use different arenas.
+	 */
+	template <class T>
+	template <class U>
+	bool arena_allocator<T>::operator!= (const arena_allocator<U>& other) const {
+		return region != other.region;
+	}
+	
+	/**
+	 * \brief The arena backed version of \ref map "extended::map<A, B>" for short lived maps.
+	 * 
+	 * \details Every node of the map comes from an \ref arena "extended::arena" the map owns. When \c A and \c B are trivially destructible, destroying the map or calling \c clear does not visit the nodes at all, the arena is just released. Otherwise the nodes are destroyed first as usual and only the freeing is skipped.
+	 * \note Erased nodes are not reused until \c clear, so this suits maps that are built, read and thrown away rather than maps that are changed for a long time.
+	 */
+	template <class A, class B>
+	class arena_map {
+		protected:
+			using storage = map<A, B, arena_allocator<std::pair<const A, B>>>; ///< \c storage is the type of the map in the arena.
+			
+			static const bool trivial = std::is_trivially_destructible<A>::value && std::is_trivially_destructible<B>::value; ///< \c trivial is \c true if the nodes need no destructor.
+			
+			B                      default_value = null<B>::value; ///< \c default_value is what stores the values to be ignored, this CANNOT be changed after the constructor to prevent data loss.
+			std::unique_ptr<arena> region;                         ///< \c region is where the nodes are kept.
+			alignas(storage) unsigned char space[sizeof(storage)]; ///< \c space holds the map, so it can be dropped without its destructor.
+			
+			void drop();
+		public:
+			arena_map();
+			arena_map(B);
+			arena_map(const arena_map&) = delete;
+			arena_map& operator= (const arena_map&) = delete;
+			~arena_map();
+			
+			storage&       operator*  ();
+			const storage& operator*  () const;
+			storage*       operator-> ();
+			const storage* operator-> () const;
+			
+			B    operator>> (A);
+			void operator() (std::pair<A, B>);
+			void operator<< (std::pair<A, B>);
+			void operator!  ();
+			void clear();
+			
+			std::size_t footprint() const;
+	};
+	
+	/**
+	 *  \brief Default constructor
+	 *  
+	 *  \details This default constructor uses the \ref null "extended::null<B>" \c default_value.
+	 */
+	template <class A, class B>
+	arena_map<A, B>::arena_map() : arena_map(null<B>::value) {}
+	
+	/**
+	 *  \brief Constructor.
+	 * 
+	 *  \param [in] default_val is the \c default_value for this \c extended::arena_map<A, B>.
+	 */
+	template <class A, class B>
+	arena_map<A, B>::arena_map(B default_val) : region(new arena()) {
+		default_value = default_val;
+		new (space) storage(default_value, arena_allocator<std::pair<const A, B>>(region.get()));
+	}
+	
+	/**
+	 *  \brief Destructor.
+	 *  
+	 *  \details This gives back the whole arena at once.
+	 */
+	template <class A, class B>
+	arena_map<A, B>::~arena_map() {
+		(*this).drop();
+	}
+	
+	/**
+	 * \brief This ends the map in \c space, skipping its destructor when the nodes need none.
+	 * 
+	 * \return Returns \c void.
+	 * 
+	 * \details The key filter is the only part of the map not in the arena, so it is freed first.
+	 */
+	template <class A, class B>
+	void arena_map<A, B>::drop() {
+		if constexpr (trivial) {
+			(**this).use_filter(false);
+		} else {
+			(**this).~storage();
+		}
+	}
+	
+	/**
+	 * \brief This gives the map in the arena.
+	 * 
+	 * \return Returns the map, it is a full \c extended::map.
+	 */
+	template <class A, class B>
+	typename arena_map<A, B>::storage& arena_map<A, B>::operator* () {
+		return *std::launder(reinterpret_cast<storage*>(space));
+	}
+	
+	/**
+	 * \brief This gives the map in the arena.
+	 * 
+	 * \return Returns the map, it is a full \c extended::map.
+	 */
+	template <class A, class B>
+	const typename arena_map<A, B>::storage& arena_map<A, B>::operator* () const {
+		return *std::launder(reinterpret_cast<const storage*>(space));
+	}
+	
+	/**
+	 * \brief This gives the map in the arena.
+	 * 
+	 * \return Returns the map, it is a full \c extended::map.
+	 */
+	template <class A, class B>
+	typename arena_map<A, B>::storage* arena_map<A, B>::operator-> () {
+		return &(**this);
+	}
+	
+	/**
+	 * \brief This gives the map in the arena.
+	 * 
+	 * \return Returns the map, it is a full \c extended::map.
+	 */
+	template <class A, class B>
+	const typename arena_map<A, B>::storage* arena_map<A, B>::operator-> () const {
+		return &(**this);
+	}
+	
+	/**
+	 * \brief This is \c extended::map<A, B>::operator>> on the map in the arena.
+	 * 
+	 * \param [in] input is the location of the desired value.
+	 * \return Returns the value of the location if it exists, however, if it does not exist, it will return the \c default_value.
+	 */
+	template <class A, class B>
+	B arena_map<A, B>::operator>> (A input) {
+		return (**this) >> input;
+	}
+	
+	/**
+	 * \brief This is \c extended::map<A, B>::operator() on the map in the arena.
+	 * 
+	 * \param [in] input is the pair of the location and the desired value.
+	 * \return Returns \c void.
+	 */
+	template <class A, class B>
+	void arena_map<A, B>::operator() (std::pair<A, B> input) {
+		(**this)(input);
+	}
+	
+	/**
+	 * \brief This is \c extended::map<A, B>::operator<< on the map in the arena.
+	 * 
+	 * \param [in] input is the pair of the location and the desired value.
+	 * \return Returns \c void.
+	 */
+	template <class A, class B>
+	void arena_map<A, B>::operator<< (std::pair<A, B> input) {
+		(**this) << input;
+	}
+	
+	/**
+	 * \brief This is \c extended::map<A, B>::operator! on the map in the arena.
+	 * 
+	 * \return Returns \c void.
+	 */
+	template <class A, class B>
+	void arena_map<A, B>::operator! () {
+		!(**this);
+	}
+	
+	/**
+	 * \brief This empties the map and releases the arena, keeping its newest block for the next entries.
+	 * 
+	 * \return Returns \c void.
+	 */
+	template <class A, class B>
+	void arena_map<A, B>::clear() {
+		(*this).drop();
+		(*region).release();
+		new (space) storage(default_value, arena_allocator<std::pair<const A, B>>(region.get()));
+	}
+	
+	/**
+	 * \brief This counts the memory the arena holds.
+	 * 
+	 * \return Returns the total size of the blocks of the arena in bytes.
+	 */
+	template <class A, class B>
+	std::size_t arena_map<A, B>::footprint() const {
+		return (*region).footprint();
+	}
+	///@}
+	
+	/**
+	 * \defgroup concurrent extended::concurrent_map
+	 * 
+	 * \brief The thread safe version of \ref map "extended::map<A, B>".
+	 * 
+	 * \details This class splits the keys across a number of shards by their hash, each shard has its own lock, so threads working on different shards never wait on each other.
+	 * @{
+	 */
+	/**
+	 * \brief The thread safe version of \ref map "extended::map<A, B>".
+	 * 
+	 * \details This class splits the keys across a number of shards by their hash, each shard has its own lock. Reads share the lock of their shard, writes and \c operator! take it alone, so compacting one shard never stops the others.
+	 * \details On a NUMA machine the shards are spread over the nodes in turn, and each shard and the entries in it are kept in memory on its node, so a thread can use \c node_of to send work for a key to a thread on the node that holds it.
+	 * \note Key types without \c std::hash\<A\> are all placed in the first shard.
+	 */
+	template <class A, class B>
+	class concurrent_map {
+		protected:
+			using storage = std::map<A, B, std::less<A>, slab_allocator<std::pair<const A, B>>>; ///< \c storage is the map of one shard, its entries come from the slab of the shard.
+			
+			/**
+			 * \brief One part of the keys with its own lock and slab, each is kept on its own cache line on its NUMA node.
+			 */
+			struct alignas(64) shard {
+				mutable std::shared_mutex lock; ///< \c lock is shared by readers and held alone by writers.
+				slab                      pool; ///< \c pool is where the entries of this shard are kept.
+				storage                   data; ///< \c data is the keys of this shard.
+				
+				shard(int node) : pool(node), data(slab_allocator<std::pair<const A, B>>(&pool)) {}
+			};
+			
+			/**
+			 * \brief This destroys a shard and gives its memory back to its node.
+			 */
+			struct release {
+				void operator() (shard* part) const {
+					(*part).~shard();
+					numa::release(part, (sizeof(shard) + 4095) / 4096 * 4096);
+				}
+			};
+			
+			/**
+			 * \brief This gives back the memory of a shard that was never made.
+			 */
+			struct unplaced {
+				std::size_t bytes; ///< \c bytes is the size of the memory.
+				
+				void operator() (void* memory) const {
+					numa::release(memory, bytes);
+				}
+			};
+			
+			B                                            default_value = null<B>::value; ///< \c default_value is what stores the values to be ignored, this CANNOT be changed after the constructor to prevent data loss.
+			std::vector<std::unique_ptr<shard, release>> shards;                        ///< \c shards is the parts of the map, this CANNOT be changed after the constructor.
+			
+			std::size_t shard_of(const A&) const;
+		public:
+			concurrent_map();
+			concurrent_map(B);
+			concurrent_map(B, std::size_t);
+			
+			B    operator>> (A) const;
+			void operator() (std::pair<A, B>);
+			void operator<< (std::pair<A, B>);
+			void operator!  ();
+			
+			std::size_t size() const;
+			std::size_t shard_count() const;
+			int         node_of(const A&) const;
+	};
+	
+	/**
+	 *  \brief Default constructor
+	 *  
+	 *  \details This default constructor makes 16 shards using the \ref null "extended::null<B>" \c default_value.
+	 */
+	template <class A, class B>
+	concurrent_map<A, B>::concurrent_map() : concurrent_map(null<B>::value, 16) {}
+	
+	/**
+	 *  \brief Constructor.
+	 * 
+	 *  \param [in] default_val is the \c default_value for this \c extended::concurrent_map<A, B>.
+	 * 
+	 *  \details This constructor makes 16 shards and sets \c default_value to \c default_val.
+	 */
+	template <class A, class B>
+	concurrent_map<A, B>::concurrent_map(B default_val) : concurrent_map(default_val, 16) {}
+	
+	/**
+	 *  \brief Constructor.
+	 * 
+	 *  \param [in] default_val is the \c default_value for this \c extended::concurrent_map<A, B>.
+	 *  \param [in] count is the number of shards, it is raised to 1 if it is 0.
+	 * 
+	 *  \details This constructor makes \c count shards and sets \c default_value to \c default_val. More shards lets more threads write at once, and on a NUMA machine shard \c i is placed on node \c i modulo the number of nodes.
+	 *  \details Each shard's memory is owned until its shard is made, and \c shards has room for every shard before the first is made, so if making one throws every shard and page made so far is given back.
+	 */
+	template <class A, class B>
+	concurrent_map<A, B>::concurrent_map(B default_val, std::size_t count) {
+		default_value = default_val;
+		if (count == 0) {
+			count = 1;
+		}
+		int         nodes = numa::nodes();
+		std::size_t bytes = (sizeof(shard) + 4095) / 4096 * 4096;
+		shards.reserve(count);
+		for (std::size_t i = 0; i < count; i++) {
+			int   node = (nodes > 1) ? (int)(i % nodes) : -1;
+			std::unique_ptr<void, unplaced> raw(numa::allocate(bytes, node), unplaced{bytes});
+			shards.emplace_back(new (raw.get()) shard(node));
+			raw.release();
+		}
+	}
+	
+	/**
+	 * \brief This picks the shard a key belongs to.
+	 * 
+	 * \param [in] key is the key.
+	 * \return Returns the index of the shard.
+	 */
+	template <class A, class B>
+	std::size_t concurrent_map<A, B>::shard_of(const A& key) const {
+		if constexpr (hashable<A>::value) {
+			uint64_t h = (uint64_t)std::hash<A>()(key) * 0x9e3779b97f4a7c15ULL;
+			return (std::size_t)((h >> 32) % shards.size());
+		} else {
+			return 0;
+		}
+	}
+	
+	/**
+	 * \brief This is the thread safe version of \c extended::map<A, B>::operator>> .
+	 * 
+	 * \param [in] input is the location of the desired value.
+	 * \return Returns the value of the location if it exists, however, if it does not exist, it will return the \c default_value.
+	 */
+	template <class A, class B>
+	B concurrent_map<A, B>::operator>> (A input) const {
+		const shard& part = *shards[(*this).shard_of(input)];
+		std::shared_lock<std::shared_mutex> hold(part.lock);
+		auto it = part.data.find(input);
+		if (it != part.data.end()) {
+			return (*it).second;
+		}
+		return default_value;
+	}
+	
+	/**
+	 * \brief This is the thread safe version of \c extended::map<A, B>::operator() .
+	 * 
+	 * \param [in] input is the pair of the location and the desired value.
+	 * \return Returns \c void.
+	 */
+	template <class A, class B>
+	void concurrent_map<A, B>::operator() (std::pair<A, B> input) {
+		shard& part = *shards[(*this).shard_of(input.first)];
+		std::unique_lock<std::shared_mutex> hold(part.lock);
+		auto it = part.data.lower_bound(input.first);
+		if ((it != part.data.end()) && !part.data.key_comp()(input.first, (*it).first)) {
+			(*it).second = input.second;
+		} else if (input.second != default_value) {
+			part.data.emplace_hint(it, input.first, input.second);
+		}
+	}
+	
+	/**
+	 * \brief This is the thread safe version of \c extended::map<A, B>::operator<< .
+	 * 
+	 * \param [in] input is the pair of the location and the desired value.
+	 * \return Returns \c void.
+	 */
+	template <class A, class B>
+	void concurrent_map<A, B>::operator<< (std::pair<A, B> input) {
+		shard& part = *shards[(*this).shard_of(input.first)];
+		std::unique_lock<std::shared_mutex> hold(part.lock);
+		auto it = part.data.lower_bound(input.first);
+		bool found = (it != part.data.end()) && !part.data.key_comp()(input.first, (*it).first);
+		if (input.second != default_value) {
+			if (found) {
+				(*it).second = input.second;
+			} else {
+				part.data.emplace_hint(it, input.first, input.second);
+			}
+		} else if (found) {
+			part.data.erase(it);
+		}
+	}
+	
+	/**
+	 * \brief This removes any \c default_value from the map, one shard at a time.
+	 * 
+	 * \return Returns \c void.
+	 * 
+	 * \details Only the shard being compacted is locked, the other shards can still be read and written.
+	 */
+	template <class A, class B>
+	void concurrent_map<A, B>::operator! () {
+		for (auto& part : shards) {
+			std::unique_lock<std::shared_mutex> hold((*part).lock);
+			for (auto it = (*part).data.begin(); it != (*part).data.end(); ) {
+				if ((*it).second == default_value) {
+					it = (*part).data.erase(it);
+				} else {
+					std::advance(it, 1);
+				}
+			}
+		}
+	}
+	
+	/**
+	 * \brief This counts the entries in every shard.
+	 * 
+	 * \return Returns the number of entries, it may already be out of date if other threads are writing.
+	 */
+	template <class A, class B>
+	std::size_t concurrent_map<A, B>::size() const {
+		std::size_t total = 0;
+		for (auto& part : shards) {
+			std::shared_lock<std::shared_mutex> hold((*part).lock);
+			total += (*part).data.size();
+		}
+		return total;
+	}
+	
+	/**
+	 * \brief This gets the number of shards.
+	 * 
+	 * \return Returns the number of shards.
+	 */
+	template <class A, class B>
+	std::size_t concurrent_map<A, B>::shard_count() const {
+		return shards.size();
+	}
+	
+	/**
+	 * \brief This finds the NUMA node that holds a key.
+	 * 
+	 * \param [in] key is the key.
+	 * \return Returns the node, or -1 if the map is not placed on nodes. Comparing it to \c numa::current() tells if a lookup of the key is local.
+	 */
+	template <class A, class B>
+	int concurrent_map<A, B>::node_of(const A& key) const {
+		return (*shards[(*this).shard_of(key)]).pool.home();
+	}
+	
+	/**
+	 * \brief The read mostly version of \ref concurrent_map "extended::concurrent_map<A, B>".
+	 * 
+	 * \details Readers never take a lock and never write to shared memory, they read a shard under a sequence lock and try again if a writer changed the shard while they were reading. Writers still take the lock of their shard and bump its sequence number around each change.
+	 * \note \c A and \c B must be trivially copyable and \c A must have \c std::hash\<A\> and \c operator== , because readers copy entries word by word while a writer may be changing them. Neither needs a default constructor. Each shard is an open addressed table rather than a \c std::map, so this map is not ordered.
+	 * \note When a shard grows, its old table is kept until the map is destroyed so that readers that are still in it stay safe, tables only ever double so the old tables together are never larger than the current one.
+	 */
+	template <class A, class B>
+	class seqlock_map {
+		static_assert(std::is_trivially_copyable<A>::value && std::is_trivially_copyable<B>::value, "extended::seqlock_map needs trivially copyable keys and values");
+		static_assert(hashable<A>::value, "extended::seqlock_map needs std::hash of the key type");
+		protected:
+			static const std::size_t key_words   = (sizeof(A) + 7) / 8; ///< \c key_words is the number of words a key takes.
+			static const std::size_t value_words = (sizeof(B) + 7) / 8; ///< \c value_words is the number of words a value takes.
+			
+			/**
+			 * \brief One entry of a shard table, every word is atomic so that readers may race with writers.
+			 */
+			struct slot {
+				std::atomic<uint64_t> state{0};              ///< \c state is 0 for never used, 1 for in use, 2 for erased.
+				std::atomic<uint64_t> key[key_words]     = {}; ///< \c key is the bytes of the key.
+				std::atomic<uint64_t> value[value_words] = {}; ///< \c value is the bytes of the value.
+			};
+			
+			/**
+			 * \brief One part of the keys with its own sequence number and write lock, each is kept on its own cache line.
+			 */
+			struct alignas(64) shard {
+				std::atomic<uint64_t>                           sequence{0};   ///< \c sequence is odd while a writer is changing the shard.
+				std::atomic<std::vector<slot>*>                 table{nullptr}; ///< \c table is the current open addressed table, its size is a power of 2.
+				std::mutex                                      lock;          ///< \c lock is held by writers.
+				std::size_t                                     used = 0;      ///< \c used is the number of slots that are not never used.
+				std::size_t                                     live = 0;      ///< \c live is the number of slots in use.
+				std::vector<std::unique_ptr<std::vector<slot>>> tables; ///< \c tables owns the current table and the old tables readers may still be in.
+			};
+			
+			B                                   default_value = null<B>::value; ///< \c default_value is what stores the values to be ignored, this CANNOT be changed after the constructor to prevent data loss.
+			std::vector<std::unique_ptr<shard>> shards;                        ///< \c shards is the parts of the map, this CANNOT be changed after the constructor.
+			
+			static void     store(std::atomic<uint64_t>*, const void*, std::size_t);
+			static void     load(const std::atomic<uint64_t>*, void*, std::size_t);
+			template<class T> static T read(const std::atomic<uint64_t>*);
+			static uint64_t hash_of(const A&);
+			
+			shard& shard_of(const A&) const;
+			slot*  find(std::vector<slot>&, const A&) const;
+			void   rebuild(shard&, std::size_t);
+			void   write(const A&, const B&, bool);
+		public:
+			seqlock_map();
+			seqlock_map(B);
+			seqlock_map(B, std::size_t);
+			
+			B    operator>> (A) const;
+			void operator() (std::pair<A, B>);
+			void operator<< (std::pair<A, B>);
+			void operator!  ();
+			
+			std::size_t size() const;
+	};
+	
+	/**
+	 *  \brief Default constructor
+	 *  
+	 *  \details This default constructor makes 16 shards using the \ref null "extended::null<B>" \c default_value.
+	 */
+	template <class A, class B>
+	seqlock_map<A, B>::seqlock_map() : seqlock_map(null<B>::value, 16) {}
+	
+	/**
+	 *  \brief Constructor.
+	 * 
+	 *  \param [in] default_val is the \c default_value for this \c extended::seqlock_map<A, B>.
+	 * 
+	 *  \details This constructor makes 16 shards and sets \c default_value to \c default_val.
+	 */
+	template <class A, class B>
+	seqlock_map<A, B>::seqlock_map(B default_val) : seqlock_map(default_val, 16) {}
+	
+	/**
+	 *  \brief Constructor.
+	 * 
+	 *  \param [in] default_val is the \c default_value for this \c extended::seqlock_map<A, B>.
+	 *  \param [in] count is the number of shards, it is raised to 1 if it is 0.
+	 * 
+	 *  \details This constructor makes \c count shards and sets \c default_value to \c default_val, it is set in the initializer list so that \c B does not need a default constructor.
+	 */
+	template <class A, class B>
+	seqlock_map<A, B>::seqlock_map(B default_val, std::size_t count) : default_value(default_val) {
+		if (count == 0) {
+			count = 1;
+		}
+		for (std::size_t i = 0; i < count; i++) {
+			shards.emplace_back(new shard());
+			(*this).rebuild(*shards.back(), 16);
+		}
+	}
+	
+	/**
+	 * \brief This copies bytes into atomic words.
+	 * 
+	 * \param [out] words is where the bytes go.
+	 * \param [in] bytes is the bytes.
+	 * \param [in] length is the number of bytes.
+	 * \return Returns \c void.
+	 */
+	template <class A, class B>
+	void seqlock_map<A, B>::store(std::atomic<uint64_t>* words, const void* bytes, std::size_t length) {
+		for (std::size_t i = 0; i * 8 < length; i++) {
+			uint64_t word = 0;
+			std::memcpy(&word, (const char*)bytes + i * 8, std::min<std::size_t>(8, length - i * 8));
+			words[i].store(word, std::memory_order_relaxed);
+		}
+	}
+	
+	/**
+	 * \brief This copies atomic words out into bytes.
+	 * 
+	 * \param [in] words is where the bytes are.
+	 * \param [out] bytes is where the bytes go.
+	 * \param [in] length is the number of bytes.
+	 * \return Returns \c void.
+	 */
+	template <class A, class B>
+	void seqlock_map<A, B>::load(const std::atomic<uint64_t>* words, void* bytes, std::size_t length) {
+		for (std::size_t i = 0; i * 8 < length; i++) {
+			uint64_t word = words[i].load(std::memory_order_relaxed);
+			std::memcpy((char*)bytes + i * 8, &word, std::min<std::size_t>(8, length - i * 8));
+		}
+	}
+	
+	/**
+	 * \brief This copies atomic words out into a key or value.
+	 * 
+	 * \param [in] words is where the bytes are.
+	 * \return Returns the key or value, made from its bytes without needing a default constructor.
+	 */
+	template <class A, class B>
+	template <class T>
+	T seqlock_map<A, B>::read(const std::atomic<uint64_t>* words) {
+		alignas(T) unsigned char bytes[sizeof(T)];
+		load(words, bytes, sizeof(T));
+		return *std::launder(reinterpret_cast<const T*>(bytes));
+	}
+	
+	/**
+	 * \brief This hashes a key so that every bit depends on every bit of \c std::hash\<A\>.
+	 * 
+	 * \param [in] key is the key.
+	 * \return Returns the hash.
+	 */
+	template <class A, class B>
+	uint64_t seqlock_map<A, B>::hash_of(const A& key) {
+		uint64_t h = (uint64_t)std::hash<A>()(key) * 0x9e3779b97f4a7c15ULL;
+		return h ^ (h >> 29);
+	}
+	
+	/**
+	 * \brief This picks the shard a key belongs to.
+	 * 
+	 * \param [in] key is the key.
+	 * \return Returns the shard.
+	 */
+	template <class A, class B>
+	typename seqlock_map<A, B>::shard& seqlock_map<A, B>::shard_of(const A& key) const {
+		return *shards[(std::size_t)((hash_of(key) >> 40) % shards.size())];
+	}
+	
+	/**
+	 * \brief This looks for the slot of a key in a table.
+	 * 
+	 * \param [in] table is the table to look in.
+	 * \param [in] key is the key.
+	 * \return Returns the slot that holds the key, or the never used slot that ends its probe sequence.
+	 * 
+	 * \details Readers may call this while a writer is changing the table, what it finds is only trusted if the sequence number did not change. Keys are compared with \c operator== , not by their bytes, so padding and values like \c -0.0 and \c 0.0 are handled.
+	 */
+	template <class A, class B>
+	typename seqlock_map<A, B>::slot* seqlock_map<A, B>::find(std::vector<slot>& table, const A& key) const {
+		std::size_t mask = table.size() - 1;
+		for (std::size_t i = (std::size_t)hash_of(key) & mask, n = 0; n <= mask; i = (i + 1) & mask, n++) {
+			uint64_t state = table[i].state.load(std::memory_order_relaxed);
+			if (state == 0) {
+				return &table[i];
+			}
+			if ((state == 1) && (read<A>(table[i].key) == key)) {
+				return &table[i];
+			}
+		}
+		return nullptr;
+	}
+	
+	/**
+	 * \brief This rehashes the live entries of a shard, dropping erased entries and \c default_value entries.
+	 * 
+	 * \param [in,out] part is the shard, the caller holds its lock and has made its sequence number odd, or is the only user.
+	 * \param [in] capacity is the smallest size of the table afterwards.
+	 * \return Returns \c void.
+	 * 
+	 * \details The table is rehashed in place if it is already big enough, readers that were in it will see the sequence number change and try again. Otherwise a table twice the size or more is made and the old one is kept, since a reader may still be in it.
+	 */
+	template <class A, class B>
+	void seqlock_map<A, B>::rebuild(shard& part, std::size_t capacity) {
+		std::vector<slot>* table = part.table.load(std::memory_order_relaxed);
+		std::size_t        size  = (table != nullptr) ? (*table).size() : 16;
+		while (size < capacity) {
+			size *= 2;
+		}
+		std::vector<std::pair<A, B>> entries;
+		if (table != nullptr) {
+			for (auto& entry : *table) {
+				if (entry.state.load(std::memory_order_relaxed) == 1) {
+					std::pair<A, B> item(read<A>(entry.key), read<B>(entry.value));
+					if (item.second != default_value) {
+						entries.push_back(item);
+					}
+				}
+				entry.state.store(0, std::memory_order_relaxed);
+			}
+		}
+		if ((table == nullptr) || ((*table).size() != size)) {
+			part.tables.emplace_back(new std::vector<slot>(size));
+			table = part.tables.back().get();
+		}
+		for (auto& item : entries) {
+			slot* target = (*this).find(*table, item.first);
+			store(target->key, &item.first, sizeof(A));
+			store(target->value, &item.second, sizeof(B));
+			target->state.store(1, std::memory_order_relaxed);
+		}
+		part.used = entries.size();
+		part.live = entries.size();
+		part.table.store(table, std::memory_order_release);
+	}
+	
+	/**
+	 * \brief This saves or erases one key under the lock and sequence number of its shard.
+	 * 
+	 * \param [in] key is the key.
+	 * \param [in] value is the value.
+	 * \param [in] keep is \c true to save \c value even if it is the \c default_value as long as the key is already in use, like \c operator() .
+	 * \return Returns \c void.
+	 */
+	template <class A, class B>
+	void seqlock_map<A, B>::write(const A& key, const B& value, bool keep) {
+		shard& part = (*this).shard_of(key);
+		std::lock_guard<std::mutex> hold(part.lock);
+		std::vector<slot>& table = *part.table.load(std::memory_order_relaxed);
+		slot* target = (*this).find(table, key);
+		bool  found  = (target != nullptr) && (target->state.load(std::memory_order_relaxed) == 1);
+		bool  erase  = !(value != default_value) && !(keep && found);
+		if (erase && !found) {
+			return;
+		}
+		uint64_t sequence = part.sequence.load(std::memory_order_relaxed);
+		part.sequence.store(sequence + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		if ((target == nullptr) || (!found && ((part.used + 1) * 4 > table.size() * 3))) {
+			(*this).rebuild(part, (part.live + 1) * 2);
+			target = (*this).find(*part.table.load(std::memory_order_relaxed), key);
+		}
+		if (erase) {
+			target->state.store(2, std::memory_order_relaxed);
+			part.live--;
+		} else {
+			if (!found) {
+				store(target->key, &key, sizeof(A));
+				target->state.store(1, std::memory_order_relaxed);
+				part.used++;
+				part.live++;
+			}
+			store(target->value, &value, sizeof(B));
+		}
+		part.sequence.store(sequence + 2, std::memory_order_release);
+	}
+	
+	/**
+	 * \brief This is the lock free version of \c extended::map<A, B>::operator>> .
+	 * 
+	 * \param [in] input is the location of the desired value.
+	 * \return Returns the value of the location if it exists, however, if it does not exist, it will return the \c default_value.
+	 * 
+	 * \details The read is tried again if a writer changed the shard while it was running, it never writes to shared memory.
+	 */
+	template <class A, class B>
+	B seqlock_map<A, B>::operator>> (A input) const {
+		shard& part = (*this).shard_of(input);
+		while (true) {
+			uint64_t sequence = part.sequence.load(std::memory_order_acquire);
+			if ((sequence & 1) != 0) {
+				std::this_thread::yield();
+				continue;
+			}
+			slot* target = (*this).find(*part.table.load(std::memory_order_acquire), input);
+			bool  found  = (target != nullptr) && (target->state.load(std::memory_order_relaxed) == 1);
+			alignas(B) unsigned char bytes[sizeof(B)];
+			if (found) {
+				load(target->value, bytes, sizeof(B));
+			}
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (part.sequence.load(std::memory_order_relaxed) == sequence) {
+				if (!found) {
+					return default_value;
+				}
+				return *std::launder(reinterpret_cast<const B*>(bytes));
+			}
+		}
+	}
+	
+	/**
+	 * \brief This is the thread safe version of \c extended::map<A, B>::operator() .
+	 * 
+	 * \param [in] input is the pair of the location and the desired value.
+	 * \return Returns \c void.
+	 */
+	template <class A, class B>
+	void seqlock_map<A, B>::operator() (std::pair<A, B> input) {
+		(*this).write(input.first, input.second, true);
+	}
+	
+	/**
+	 * \brief This is the thread safe version of \c extended::map<A, B>::operator<< .
+	 * 
+	 * \param [in] input is the pair of the location and the desired value.
+	 * \return Returns \c void.
+	 */
+	template <class A, class B>
+	void seqlock_map<A, B>::operator<< (std::pair<A, B> input) {
+		(*this).write(input.first, input.second, false);
+	}
+	
+	/**
+	 * \brief This removes any \c default_value and erased entries from the map, one shard at a time.
+	 * 
+	 * \return Returns \c void.
+	 * 
+	 * \details Each shard is rehashed in place while its sequence number is odd, readers of that shard wait and try again, the other shards are not touched.
+	 */
+	template <class A, class B>
+	void seqlock_map<A, B>::operator! () {
+		for (auto& part : shards) {
+			std::lock_guard<std::mutex> hold((*part).lock);
+			uint64_t sequence = (*part).sequence.load(std::memory_order_relaxed);
+			(*part).sequence.store(sequence + 1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+			(*this).rebuild(*part, (*part).live * 2);
+			(*part).sequence.store(sequence + 2, std::memory_order_release);
+		}
+	}
+	
+	/**
+	 * \brief This counts the entries in every shard.
+	 * 
+	 * \return Returns the number of entries, it may already be out of date if other threads are writing.
+	 */
+	template <class A, class B>
+	std::size_t seqlock_map<A, B>::size() const {
+		std::size_t total = 0;
+		for (auto& part : shards) {
+			std::lock_guard<std::mutex> hold((*part).lock);
+			total += (*part).live;
+		}
+		return total;
+	}
+	
+	/**
+	 * \brief The epoch based reclamation used by the lock free maps.
+	 * 
+	 * \details A reader holds an \c epoch::guard while it uses shared memory, which only writes the epoch to the reader's own slot. A writer that unlinks memory notes the epoch with \c retire and frees it once \c safe says that every reader that could have seen it is done.
+	 * \note Slots are claimed once per thread and given back when the thread ends, they are never freed, so there are only ever as many as the most threads that were alive at once.
+	 */
+	class epoch {
+		protected:
+			/**
+			 * \brief The epoch a reader thread is in, each is kept on its own cache line.
+			 */
+			struct alignas(64) slot {
+				std::atomic<uint64_t> pinned{UINT64_MAX}; ///< \c pinned is the epoch the thread is reading in, or \c UINT64_MAX if it is not reading.
+				std::atomic<bool>     taken{false};       ///< \c taken is \c true while a thread owns the slot.
+				slot*                 next = nullptr;     ///< \c next is the next slot in the list.
+			};
+			
+			/**
+			 * \brief The slot of the current thread, it is given back when the thread ends.
+			 */
+			struct owner {
+				slot*    mine  = nullptr; ///< \c mine is the slot of the thread.
+				unsigned depth = 0;       ///< \c depth is the number of guards the thread holds.
+				
+				~owner() {
+					if (mine != nullptr) {
+						(*mine).taken.store(false, std::memory_order_release);
+					}
+				}
+			};
+			
+			static inline std::atomic<uint64_t> global{1};      ///< \c global is the current epoch.
+			static inline std::atomic<slot*>    slots{nullptr}; ///< \c slots is the list of every slot.
+			
+			static owner& local();
+		public:
+			/**
+			 * \brief While a guard is alive, memory retired after it was made will not be freed.
+			 */
+			class guard {
+				protected:
+					bool active = true; ///< \c active is \c false once the guard has been moved from.
+				public:
+					guard();
+					guard(guard&&);
+					guard(const guard&) = delete;
+					guard& operator= (const guard&) = delete;
+					~guard();
+			};
+			
+			static uint64_t retire();
+			static bool     safe(uint64_t);
+	};
+	
+	/**
+	 * \brief This gets the slot of the current thread, claiming one the first time.
+	 * 
+	 * \return Returns the owner of the slot of the current thread.
+	 */
+	inline epoch::owner& epoch::local() {
+		static thread_local owner self;
+		if (self.mine == nullptr) {
+			for (slot* it = slots.load(std::memory_order_acquire); it != nullptr; it = (*it).next) {
+				bool expected = false;
+				if (!(*it).taken.load(std::memory_order_relaxed) && (*it).taken.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+					self.mine = it;
+					return self;
+				}
+			}
+			slot* fresh = new slot();
+			(*fresh).taken.store(true, std::memory_order_relaxed);
+			(*fresh).next = slots.load(std::memory_order_relaxed);
+			while (!slots.compare_exchange_weak((*fresh).next, fresh, std::memory_order_release, std::memory_order_relaxed)) {}
+			self.mine = fresh;
+		}
+		return self;
+	}
+	
+	/**
+	 * \brief Constructor.
+	 * 
+	 * \details This marks the current thread as reading in the current epoch, guards on the same thread may be nested.
+	 */
+	inline epoch::guard::guard() {
+		owner& self = local();
+		if (self.depth++ == 0) {
+			(*self.mine).pinned.store(global.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+		}
+	}
+	
+	/**
+	 * \brief Move constructor.
+	 * 
+	 * \details The guard that is moved from no longer protects anything, the guard must stay on the thread that made it.
+	 */
+	inline epoch::guard::guard(guard&& other) {
+		other.active = false;
+	}
+	
+	/**
+	 * \brief Destructor.
+	 * 
+	 * \details This marks the current thread as done reading once its outermost guard ends.
+	 */
+	inline epoch::guard::~guard() {
+		if (active) {
+			owner& self = local();
+			if (--self.depth == 0) {
+				(*self.mine).pinned.store(UINT64_MAX, std::memory_order_release);
+			}
+		}
+	}
+	
+	/**
+	 * \brief This starts a new epoch after memory has been unlinked.
+	 * 
+	 * \return Returns the epoch to pass to \c safe before freeing the memory.
+	 * 
+	 * \details The memory must already be unreachable from the shared structure when this is called.
+	 */
+	inline uint64_t epoch::retire() {
+		return global.fetch_add(1, std::memory_order_seq_cst);
+	}
+	
+	/**
+	 * \brief This checks if memory retired in an epoch may be freed.
+	 * 
+	 * \param [in] retired is the value returned by \c retire.
+	 * \return Returns \c true if no reader is still in that epoch or an earlier one.
+	 */
+	inline bool epoch::safe(uint64_t retired) {
+		for (slot* it = slots.load(std::memory_order_acquire); it != nullptr; it = (*it).next) {
+			if ((*it).pinned.load(std::memory_order_seq_cst) <= retired) {
+				return false;
+			}
+		}
+		return true;
+	}
+	
+	/**
+	 * \brief The read copy update version of \ref map "extended::map<A, B>" for maps that are read far more than they are changed.
+	 * 
+	 * \details Readers use an immutable version of the map without any lock. Writers queue their changes, and \c publish builds a new compacted version with them and swaps it in atomically. Old versions are freed through \ref epoch "extended::epoch" once no reader can still be using them.
+	 * \details \c publish waits up to a millisecond for readers still in the old version and frees it then. A version a reader holds longer, through a snapshot, is freed when the last such snapshot ends, or at the next write or publish.
+	 */
+	template <class A, class B>
+	class rcu_map {
+		protected:
+			B                                                    default_value = null<B>::value; ///< \c default_value is what stores the values to be ignored, this CANNOT be changed after the constructor to prevent data loss.
+			std::atomic<const map<A, B>*>                        current{nullptr};               ///< \c current is the version readers use.
+			mutable std::mutex                                   lock;                           ///< \c lock is held by writers and while old versions are freed.
+			std::vector<std::pair<A, B>>                         pending;                        ///< \c pending is the changes for the next version.
+			mutable std::vector<std::pair<uint64_t, const map<A, B>*>> retired;                  ///< \c retired is the old versions and the epochs they were retired in.
+			
+			void reclaim() const;
+			void collect() const;
+		public:
+			/**
+			 * \brief A pinned version of the map, it stays the same and is not freed while the snapshot is alive.
+			 * 
+			 * \note A snapshot must be used and destroyed on the thread that made it.
+			 */
+			class snapshot {
+				protected:
+					std::optional<epoch::guard> hold;          ///< \c hold keeps the version from being freed.
+					const rcu_map*              owner;         ///< \c owner is the map, it frees old versions when the snapshot ends.
+					const map<A, B>*            view;          ///< \c view is the version.
+					B                           default_value; ///< \c default_value is the \c default_value of the map.
+				public:
+					snapshot(const rcu_map*, const map<A, B>*, B);
+					snapshot(snapshot&&) = default;
+					~snapshot();
+					
+					B                operator>> (A) const;
+					const map<A, B>& operator*  () const;
+					const map<A, B>* operator-> () const;
+			};
+			
+			rcu_map();
+			rcu_map(B);
+			rcu_map(const rcu_map&) = delete;
+			rcu_map& operator= (const rcu_map&) = delete;
+			~rcu_map();
+			
+			B        operator>> (A) const;
+			void     operator() (std::pair<A, B>);
+			void     operator<< (std::pair<A, B>);
+			void     operator!  ();
+			snapshot pin() const;
+			void     publish();
+	};
+	
+	/**
+	 *  \brief Constructor.
+	 * 
+	 *  \param [in] from is the map.
+	 *  \param [in] version is the version to pin, the caller already holds a guard.
+	 *  \param [in] default_val is the \c default_value of the map.
+	 */
+	template <class A, class B>
+	rcu_map<A, B>::snapshot::snapshot(const rcu_map* from, const map<A, B>* version, B default_val) : hold(std::in_place), owner(from), view(version), default_value(default_val) {}
+	
+	/**
+	 *  \brief Destructor.
+	 *  
+	 *  \details This lets go of the version and then frees the old versions no reader is in any more, so a version is not kept for a whole publish after its last snapshot.
+	 */
+	template <class A, class B>
+	rcu_map<A, B>::snapshot::~snapshot() {
+		hold.reset();
+		if (owner != nullptr) {
+			(*owner).collect();
+		}
+	}
+	
+	/**
+	 * \brief This is \c extended::map<A, B>::operator>> on the pinned version.
+	 * 
+	 * \param [in] input is the location of the desired value.
+	 * \return Returns the value of the location if it exists, however, if it does not exist, it will return the \c default_value.
+	 */
+	template <class A, class B>
+	B rcu_map<A, B>::snapshot::operator>> (A input) const {
+		auto it = (*view).find(input);
+		if (it != (*view).end()) {
+			return (*it).second;
+		}
+		return default_value;
+	}
+	
+	/**
+	 * \brief This gives the pinned version.
+	 * 
+	 * \return Returns the pinned version, it must not be used after the snapshot is destroyed.
+	 */
+	template <class A, class B>
+	const map<A, B>& rcu_map<A, B>::snapshot::operator* () const {
+		return *view;
+	}
+	
+	/**
+	 * \brief This gives the pinned version.
+	 * 
+	 * \return Returns the pinned version, it must not be used after the snapshot is destroyed.
+	 */
+	template <class A, class B>
+	const map<A, B>* rcu_map<A, B>::snapshot::operator-> () const {
+		return view;
+	}
+	
+	/**
+	 *  \brief Default constructor
+	 *  
+	 *  \details This default constructor publishes an empty version using the \ref null "extended::null<B>" \c default_value.
+	 */
+	template <class A, class B>
+	rcu_map<A, B>::rcu_map() : rcu_map(null<B>::value) {}
+	
+	/**
+	 *  \brief Constructor.
+	 * 
+	 *  \param [in] default_val is the \c default_value for this \c extended::rcu_map<A, B>.
+	 * 
+	 *  \details This constructor publishes an empty version and sets \c default_value to \c default_val.
+	 */
+	template <class A, class B>
+	rcu_map<A, B>::rcu_map(B default_val) {
+		default_value = default_val;
+		current.store(new map<A, B>(default_value), std::memory_order_release);
+	}
+	
+	/**
+	 *  \brief Destructor.
+	 *  
+	 *  \details This frees every version, no reader may still be using the map.
+	 */
+	template <class A, class B>
+	rcu_map<A, B>::~rcu_map() {
+		delete current.load(std::memory_order_relaxed);
+		for (auto& old : retired) {
+			delete old.second;
+		}
+	}
+	
+	/**
+	 * \brief This frees the old versions no reader can still be using, the caller holds \c lock.
+	 * 
+	 * \return Returns \c void.
+	 */
+	template <class A, class B>
+	void rcu_map<A, B>::reclaim() const {
+		std::size_t kept = 0;
+		for (auto& old : retired) {
+			if (epoch::safe(old.first)) {
+				delete old.second;
+			} else {
+				retired[kept++] = old;
+			}
+		}
+		retired.resize(kept);
+	}
+	
+	/**
+	 * \brief This frees the old versions no reader can still be using, unless a writer holds \c lock.
+	 * 
+	 * \return Returns \c void.
+	 */
+	template <class A, class B>
+	void rcu_map<A, B>::collect() const {
+		std::unique_lock<std::mutex> hold(lock, std::try_to_lock);
+		if (hold.owns_lock() && !retired.empty()) {
+			(*this).reclaim();
+		}
+	}
+	
+	/**
+	 * \brief This pins the current version so that several reads see the same map.
+	 * 
+	 * \return Returns the snapshot, it must stay on the calling thread.
+	 */
+	template <class A, class B>
+	typename rcu_map<A, B>::snapshot rcu_map<A, B>::pin() const {
+		epoch::guard hold;
+		return snapshot(this, current.load(std::memory_order_seq_cst), default_value);
+	}
+	
+	/**
+	 * \brief This is the lock free version of \c extended::map<A, B>::operator>> on the current version.
+	 * 
+	 * \param [in] input is the location of the desired value.
+	 * \return Returns the value of the location if it exists, however, if it does not exist, it will return the \c default_value.
+	 * 
+	 * \details Changes that have not been published yet are not seen.
+	 */
+	template <class A, class B>
+	B rcu_map<A, B>::operator>> (A input) const {
+		epoch::guard hold;
+		const map<A, B>& view = *current.load(std::memory_order_seq_cst);
+		auto it = view.find(input);
+		if (it != view.end()) {
+			return (*it).second;
+		}
+		return default_value;
+	}
+	
+	/**
+	 * \brief This queues a change for the next version, it is the same as \c operator<< since every version is compact.
+	 * 
+	 * \param [in] input is the pair of the location and the desired value.
+	 * \return Returns \c void.
+	 */
+	template <class A, class B>
+	void rcu_map<A, B>::operator() (std::pair<A, B> input) {
+		std::lock_guard<std::mutex> hold(lock);
+		pending.push_back(input);
+		if (!retired.empty()) {
+			(*this).reclaim();
+		}
+	}
+	
+	/**
+	 * \brief This queues a change for the next version.
+	 * 
+	 * \param [in] input is the pair of the location and the desired value.
+	 * \return Returns \c void.
+	 */
+	template <class A, class B>
+	void rcu_map<A, B>::operator<< (std::pair<A, B> input) {
+		std::lock_guard<std::mutex> hold(lock);
+		pending.push_back(input);
+		if (!retired.empty()) {
+			(*this).reclaim();
+		}
+	}
+	
+	/**
+	 * \brief This publishes a new version, every version is already compacted when it is built.
+	 * 
+	 * \return Returns \c void.
+	 */
+	template <class A, class B>
+	void rcu_map<A, B>::operator! () {
+		(*this).publish();
+	}
+	
+	/**
+	 * \brief This builds a new version with the queued changes and swaps it in for readers.
+	 * 
+	 * \return Returns \c void.
+	 * 
+	 * \details The current version is copied and the queued changes are merged into it with \c apply_batch, which already drops \c default_value results, so the new version is compact without another pass. The old version is freed as soon as no reader is in it, which for plain reads is almost always within the short wait here.
+	 */
+	template <class A, class B>
+	void rcu_map<A, B>::publish() {
+		std::lock_guard<std::mutex> hold(lock);
+		const map<A, B>* old = current.load(std::memory_order_relaxed);
+		map<A, B>* fresh = new map<A, B>(*old);
+		(*fresh).apply_batch(pending.begin(), pending.end());
+		pending.clear();
+		current.store(fresh, std::memory_order_seq_cst);
+		uint64_t when  = epoch::retire();
+		auto     limit = std::chrono::steady_clock::now() + std::chrono::milliseconds(1);
+		while (!epoch::safe(when) && (std::chrono::steady_clock::now() < limit)) {
+			std::this_thread::yield();
+		}
+		retired.emplace_back(when, old);
+		(*this).reclaim();
+	}
+	
+	/**
+	 * \brief The lock free, ordered version of \ref map "extended::map<A, B>".
+	 * 
+	 * \details This class keeps its entries in a skiplist that many threads may read, scan in order, and write at once without any lock. \c operator<< with the \c default_value only marks the entry as deleted, \c operator! is the step that unlinks deleted entries from the list, and memory is given back through \ref epoch "extended::epoch" once no reader can still be using it.
+	 * \note Only one thread should run \c operator! at a time, it takes a lock so that others wait. Writers that land next to an entry that is being unlinked wait for that unlink to finish. Writers also free retired memory themselves once enough has piled up, so churn without \c operator! does not grow memory without bound.
+	 */
+	template <class A, class B>
+	class skiplist_map {
+		protected:
+			static const int         levels    = 20;  ///< \c levels is the most levels a node may have.
+			static const std::size_t threshold = 256; ///< \c threshold is how much retired memory a writer lets pile up before it tries to free some.
+			
+			/**
+			 * \brief The links of a node, the head of the list is only links. The low bit of a link is set once its node is being unlinked.
+			 */
+			struct link {
+				std::unique_ptr<std::atomic<uintptr_t>[]> next;   ///< \c next is the link to the next node on each level.
+				int                                       height; ///< \c height is the number of levels of the node.
+				
+				link(int size) : next(new std::atomic<uintptr_t>[size]), height(size) {
+					for (int i = 0; i < size; i++) {
+						next[i].store(0, std::memory_order_relaxed);
+					}
+				}
+			};
+			
+			/**
+			 * \brief An entry of the list, its value is \c nullptr once it is deleted and \c dead() once it is being unlinked.
+			 */
+			struct node : link {
+				A                      key;            ///< \c key is the key of the entry, it never changes.
+				std::atomic<const B*>  value{nullptr}; ///< \c value is the value of the entry.
+				std::atomic<bool>      building{true}; ///< \c building is \c true until every level of the node is linked.
+				
+				node(const A& k, int size) : link(size), key(k) {}
+			};
+			
+			/**
+			 * \brief Memory waiting for readers to finish with it, kept in a lock free stack.
+			 */
+			struct retired {
+				uint64_t    when;  ///< \c when is the epoch the memory was retired in.
+				const B*    value; ///< \c value is a retired value, or \c nullptr.
+				node*       item;  ///< \c item is a retired node, or \c nullptr.
+				retired*    next;  ///< \c next is the next retired memory.
+			};
+			
+			B                        default_value = null<B>::value; ///< \c default_value is what stores the values to be ignored, this CANNOT be changed after the constructor to prevent data loss.
+			link                     head{levels};                   ///< \c head is the start of every level of the list.
+			std::atomic<retired*>    garbage{nullptr};               ///< \c garbage is the memory waiting to be freed.
+			std::atomic<std::size_t> backlog{0};                     ///< \c backlog is the number of entries in \c garbage .
+			std::mutex               compacting;                     ///< \c compacting is held by \c operator! and by a writer that is freeing retired memory.
+			
+			static const B* dead();
+			static node*    strip(uintptr_t);
+			static bool     less(const A&, const A&);
+			static int      random_height();
+			
+			void  search(const A&, link**, node**) const;
+			node* first(const A&) const;
+			void  retire_value(const B*);
+			void  reclaim();
+			void  collect();
+			void  write(const A&, const B&, bool);
+		public:
+			skiplist_map();
+			skiplist_map(B);
+			skiplist_map(const skiplist_map&) = delete;
+			skiplist_map& operator= (const skiplist_map&) = delete;
+			~skiplist_map();
+			
+			B    operator>> (A) const;
+			void operator() (std::pair<A, B>);
+			void operator<< (std::pair<A, B>);
+			void operator!  ();
+			
+			template<class F> void scan(A, A, F) const;
+			template<class F> void for_each(F) const;
+			std::size_t size() const;
+	};
+	
+	/**
+	 *  \brief Default constructor
+	 *  
+	 *  \details This default constructor makes an empty list using the \ref null "extended::null<B>" \c default_value.
+	 */
+	template <class A, class B>
+	skiplist_map<A, B>::skiplist_map() : skiplist_map(null<B>::value) {}
+	
+	/**
+	 *  \brief Constructor.
+	 * 
+	 *  \param [in] default_val is the \c default_value for this \c extended::skiplist_map<A, B>.
+	 * 
+	 *  \details This constructor makes an empty list and sets \c default_value to \c default_val.
+	 */
+	template <class A, class B>
+	skiplist_map<A, B>::skiplist_map(B default_val) {
+		default_value = default_val;
+	}
+	
+	/**
+	 *  \brief Destructor.
+	 *  
+	 *  \details This frees every node, value and retired memory, no other thread may still be using the map.
+	 */
+	template <class A, class B>
+	skiplist_map<A, B>::~skiplist_map() {
+		for (node* it = strip(head.next[0].load(std::memory_order_relaxed)); it != nullptr; ) {
+			node* next = strip((*it).next[0].load(std::memory_order_relaxed));
+			const B* value = (*it).value.load(std::memory_order_relaxed);
+			if ((value != nullptr) && (value != dead())) {
+				delete value;
+			}
+			delete it;
+			it = next;
+		}
+		for (retired* it = garbage.load(std::memory_order_relaxed); it != nullptr; ) {
+			retired* next = (*it).next;
+			delete (*it).value;
+			delete (*it).item;
+			delete it;
+			it = next;
+		}
+	}
+	
+	/**
+	 * \brief This is the value of a node that is being unlinked.
+	 * 
+	 * \return Returns an address that is never a real value.
+	 */
+	template <class A, class B>
+	const B* skiplist_map<A, B>::dead() {
+		static const char mark = 0;
+		return reinterpret_cast<const B*>(&mark);
+	}
+	
+	/**
+	 * \brief This takes the mark off of a link.
+	 * 
+	 * \param [in] next is the link.
+	 * \return Returns the node the link points to.
+	 */
+	template <class A, class B>
+	typename skiplist_map<A, B>::node* skiplist_map<A, B>::strip(uintptr_t next) {
+		return reinterpret_cast<node*>(next & ~(uintptr_t)1);
+	}
+	
+	/**
+	 * \brief This compares two keys.
+	 * 
+	 * \param [in] x is the first key.
+	 * \param [in] y is the second key.
+	 * \return Returns \c true if \c x comes before \c y.
+	 */
+	template <class A, class B>
+	bool skiplist_map<A, B>::less(const A& x, const A& y) {
+		return std::less<A>()(x, y);
+	}
+	
+	/**
+	 * \brief This picks the number of levels of a new node, each level is a quarter as likely as the one below it.
+	 * 
+	 * \return Returns the number of levels.
+	 */
+	template <class A, class B>
+	int skiplist_map<A, B>::random_height() {
+		static thread_local uint64_t state = 0x9e3779b97f4a7c15ULL ^ (uint64_t)(uintptr_t)&state;
+		state ^= state << 13;
+		state ^= state >> 7;
+		state ^= state << 17;
+		int height = 1;
+		for (uint64_t bits = state; ((bits & 3) == 0) && (height < levels); bits >>= 2) {
+			height++;
+		}
+		return height;
+	}
+	
+	/**
+	 * \brief This finds where a key goes on every level, the caller holds an \c epoch::guard.
+	 * 
+	 * \param [in] key is the key.
+	 * \param [out] preds is the last link before the key on each level.
+	 * \param [out] succs is the first node at or after the key on each level, read from \c preds.
+	 * \return Returns \c void.
+	 */
+	template <class A, class B>
+	void skiplist_map<A, B>::search(const A& key, link** preds, node** succs) const {
+		link* pred = const_cast<link*>(&head);
+		for (int i = levels - 1; i >= 0; i--) {
+			node* cur = strip((*pred).next[i].load(std::memory_order_acquire));
+			while ((cur != nullptr) && less((*cur).key, key)) {
+				pred = cur;
+				cur  = strip((*cur).next[i].load(std::memory_order_acquire));
+			}
+			preds[i] = pred;
+			succs[i] = cur;
+		}
+	}
+	
+	/**
+	 * \brief This finds the entry of a key that is not being unlinked, the caller holds an \c epoch::guard.
+	 * 
+	 * \param [in] key is the key.
+	 * \return Returns the node, or \c nullptr if there is none.
+	 */
+	template <class A, class B>
+	typename skiplist_map<A, B>::node* skiplist_map<A, B>::first(const A& key) const {
+		link* preds[levels];
+		node* succs[levels];
+		(*this).search(key, preds, succs);
+		for (node* it = succs[0]; (it != nullptr) && !less(key, (*it).key); it = strip((*it).next[0].load(std::memory_order_acquire))) {
+			if ((*it).value.load(std::memory_order_acquire) != dead()) {
+				return it;
+			}
+		}
+		return nullptr;
+	}
+	
+	/**
+	 * \brief This hands a replaced value to the epochs so that it is freed once no reader can still be using it.
+	 * 
+	 * \param [in] value is the value, it is already unreachable.
+	 * \return Returns \c void.
+	 */
+	template <class A, class B>
+	void skiplist_map<A, B>::retire_value(const B* value) {
+		retired* item = new retired{epoch::retire(), value, nullptr, garbage.load(std::memory_order_relaxed)};
+		while (!garbage.compare_exchange_weak((*item).next, item, std::memory_order_release, std::memory_order_relaxed)) {}
+		backlog.fetch_add(1, std::memory_order_relaxed);
+	}
+	
+	/**
+	 * \brief This frees the retired memory no reader can still be using, the caller holds \c compacting.
+	 * 
+	 * \return Returns \c void.
+	 */
+	template <class A, class B>
+	void skiplist_map<A, B>::reclaim() {
+		retired* list = garbage.exchange(nullptr, std::memory_order_acquire);
+		while (list != nullptr) {
+			retired* next = (*list).next;
+			if (epoch::safe((*list).when)) {
+				delete (*list).value;
+				delete (*list).item;
+				delete list;
+				backlog.fetch_sub(1, std::memory_order_relaxed);
+			} else {
+				(*list).next = garbage.load(std::memory_order_relaxed);
+				while (!garbage.compare_exchange_weak((*list).next, list, std::memory_order_release, std::memory_order_relaxed)) {}
+			}
+			list = next;
+		}
+	}
+	
+	/**
+	 * \brief This frees retired memory from the write path once more than \c threshold entries are waiting.
+	 * 
+	 * \return Returns \c void.
+	 * 
+	 * \details This is called after the writer's guard has ended, so its own epoch does not hold anything back. If another thread is already freeing or compacting it does nothing rather than wait.
+	 */
+	template <class A, class B>
+	void skiplist_map<A, B>::collect() {
+		if (backlog.load(std::memory_order_relaxed) < threshold) {
+			return;
+		}
+		std::unique_lock<std::mutex> lock(compacting, std::try_to_lock);
+		if (lock.owns_lock()) {
+			(*this).reclaim();
+		}
+	}
+	
+	/**
+	 * \brief This saves or deletes one key.
+	 * 
+	 * \param [in] key is the key.
+	 * \param [in] value is the value.
+	 * \param [in] keep is \c true to save \c value even if it is the \c default_value as long as the key is already in use, like \c operator() .
+	 * \return Returns \c void.
+	 * 
+	 * \details A live entry has its value swapped in with a CAS, deleting only swaps in \c nullptr. A new key is linked in on the bottom level with a CAS, which makes it visible, and then on its upper levels.
+	 */
+	template <class A, class B>
+	void skiplist_map<A, B>::write(const A& key, const B& value, bool keep) {
+		epoch::guard hold;
+		bool erase = !(value != default_value);
+		const B* fresh = nullptr;
+		while (true) {
+			link* preds[levels];
+			node* succs[levels];
+			(*this).search(key, preds, succs);
+			node* found = nullptr;
+			for (node* it = succs[0]; (it != nullptr) && !less(key, (*it).key); it = strip((*it).next[0].load(std::memory_order_acquire))) {
+				if ((*it).value.load(std::memory_order_acquire) != dead()) {
+					found = it;
+					break;
+				}
+			}
+			if (found != nullptr) {
+				const B* old = (*found).value.load(std::memory_order_acquire);
+				if (old == dead()) {
+					continue;
+				}
+				if (erase && (!keep || (old == nullptr))) {
+					if ((old == nullptr) || (*found).value.compare_exchange_strong(old, nullptr, std::memory_order_acq_rel)) {
+						if (old != nullptr) {
+							(*this).retire_value(old);
+						}
+						delete fresh;
+						return;
+					}
+					continue;
+				}
+				if (fresh == nullptr) {
+					fresh = new B(value);
+				}
+				if ((*found).value.compare_exchange_strong(old, fresh, std::memory_order_acq_rel)) {
+					if (old != nullptr) {
+						(*this).retire_value(old);
+					}
+					return;
+				}
+				continue;
+			}
+			if (erase) {
+				delete fresh;
+				return;
+			}
+			if (fresh == nullptr) {
+				fresh = new B(value);
+			}
+			node* item = new node(key, random_height());
+			(*item).value.store(fresh, std::memory_order_relaxed);
+			(*item).next[0].store(reinterpret_cast<uintptr_t>(succs[0]), std::memory_order_relaxed);
+			uintptr_t expected = reinterpret_cast<uintptr_t>(succs[0]);
+			if (!(*preds[0]).next[0].compare_exchange_strong(expected, reinterpret_cast<uintptr_t>(item), std::memory_order_acq_rel)) {
+				(*item).value.store(nullptr, std::memory_order_relaxed);
+				delete item;
+				if ((expected & 1) != 0) {
+					std::this_thread::yield();
+				}
+				continue;
+			}
+			for (int i = 1; i < (*item).height; i++) {
+				while (true) {
+					(*item).next[i].store(reinterpret_cast<uintptr_t>(succs[i]), std::memory_order_relaxed);
+					uintptr_t expect = reinterpret_cast<uintptr_t>(succs[i]);
+					if ((*preds[i]).next[i].compare_exchange_strong(expect, reinterpret_cast<uintptr_t>(item), std::memory_order_acq_rel)) {
+						break;
+					}
+					if ((expect & 1) != 0) {
+						std::this_thread::yield();
+					}
+					(*this).search(key, preds, succs);
+				}
+			}
+			(*item).building.store(false, std::memory_order_release);
+			return;
+		}
+	}
+	
+	/**
+	 * \brief This is the lock free version of \c extended::map<A, B>::operator>> .
+	 * 
+	 * \param [in] input is the location of the desired value.
+	 * \return Returns the value of the location if it exists, however, if it does not exist, it will return the \c default_value.
+	 */
+	template <class A, class B>
+	B skiplist_map<A, B>::operator>> (A input) const {
+		epoch::guard hold;
+		node* found = (*this).first(input);
+		if (found != nullptr) {
+			const B* value = (*found).value.load(std::memory_order_acquire);
+			if ((value != nullptr) && (value != dead())) {
+				return *value;
+			}
+		}
+		return default_value;
+	}
+	
+	/**
+	 * \brief This is the lock free version of \c extended::map<A, B>::operator() .
+	 * 
+	 * \param [in] input is the pair of the location and the desired value.
+	 * \return Returns \c void.
+	 */
+	template <class A, class B>
+	void skiplist_map<A, B>::operator() (std::pair<A, B> input) {
+		(*this).write(input.first, input.second, true);
+		(*this).collect();
+	}
+	
+	/**
+	 * \brief This is the lock free version of \c extended::map<A, B>::operator<< , the \c default_value only marks the entry as deleted.
+	 * 
+	 * \param [in] input is the pair of the location and the desired value.
+	 * \return Returns \c void.
+	 */
+	template <class A, class B>
+	void skiplist_map<A, B>::operator<< (std::pair<A, B> input) {
+		(*this).write(input.first, input.second, false);
+		(*this).collect();
+	}
+	
+	/**
+	 * \brief This unlinks every deleted or \c default_value entry from the list.
+	 * 
+	 * \return Returns \c void.
+	 * 
+	 * \details First each such entry that is fully linked is claimed by swapping its value for \c dead(), then all of its links are marked so nothing new can be linked after it, then every level is walked once and marked nodes are skipped over with a CAS. The nodes are freed through the epochs, readers and writers keep running the whole time.
+	 */
+	template <class A, class B>
+	void skiplist_map<A, B>::operator! () {
+		std::lock_guard<std::mutex> lock(compacting);
+		std::vector<node*> doomed;
+		{
+			epoch::guard hold;
+			for (node* it = strip(head.next[0].load(std::memory_order_acquire)); it != nullptr; it = strip((*it).next[0].load(std::memory_order_acquire))) {
+				if ((*it).building.load(std::memory_order_acquire)) {
+					continue;
+				}
+				const B* value = (*it).value.load(std::memory_order_acquire);
+				if ((value == dead()) || ((value != nullptr) && (*value != default_value))) {
+					continue;
+				}
+				if ((*it).value.compare_exchange_strong(value, dead(), std::memory_order_acq_rel)) {
+					if (value != nullptr) {
+						(*this).retire_value(value);
+					}
+					doomed.push_back(it);
+				}
+			}
+			for (node* item : doomed) {
+				for (int i = (*item).height - 1; i >= 0; i--) {
+					(*item).next[i].fetch_or(1, std::memory_order_acq_rel);
+				}
+			}
+			for (int i = levels - 1; i >= 0; i--) {
+				link* pred = &head;
+				node* cur  = strip((*pred).next[i].load(std::memory_order_acquire));
+				while (cur != nullptr) {
+					uintptr_t next = (*cur).next[i].load(std::memory_order_acquire);
+					if ((next & 1) == 0) {
+						pred = cur;
+						cur  = strip(next);
+						continue;
+					}
+					uintptr_t expected = reinterpret_cast<uintptr_t>(cur);
+					if ((*pred).next[i].compare_exchange_strong(expected, next & ~(uintptr_t)1, std::memory_order_acq_rel)) {
+						cur = strip(next);
+					} else {
+						cur = strip(expected);
+					}
+				}
+			}
+		}
+		if (!doomed.empty()) {
+			uint64_t when = epoch::retire();
+			for (node* item : doomed) {
+				retired* entry = new retired{when, nullptr, item, garbage.load(std::memory_order_relaxed)};
+				while (!garbage.compare_exchange_weak((*entry).next, entry, std::memory_order_release, std::memory_order_relaxed)) {}
+			}
+			backlog.fetch_add(doomed.size(), std::memory_order_relaxed);
+		}
+		(*this).reclaim();
+	}
+	
+	/**
+	 * \brief This calls a function on every live entry with a key from \c low up to but not including \c high, in order.
+	 * 
+	 * \param [in] low is the first key of the range.
+	 * \param [in] high is the key after the range.
+	 * \param [in] f is called as \c f(key, value) for each entry.
+	 * \return Returns \c void.
+	 * 
+	 * \details The scan runs while other threads write, entries that change during the scan may or may not be seen.
+	 */
+	template <class A, class B>
+	template <class F>
+	void skiplist_map<A, B>::scan(A low, A high, F f) const {
+		epoch::guard hold;
+		link* preds[levels];
+		node* succs[levels];
+		(*this).search(low, preds, succs);
+		for (node* it = succs[0]; (it != nullptr) && less((*it).key, high); it = strip((*it).next[0].load(std::memory_order_acquire))) {
+			const B* value = (*it).value.load(std::memory_order_acquire);
+			if ((value != nullptr) && (value != dead())) {
+				f((*it).key, *value);
+			}
+		}
+	}
+	
+	/**
+	 * \brief This calls a function on every live entry, in order.
+	 * 
+	 * \param [in] f is called as \c f(key, value) for each entry.
+	 * \return Returns \c void.
+	 * 
+	 * \details The scan runs while other threads write, entries that change during the scan may or may not be seen.
+	 */
+	template <class A, class B>
+	template <class F>
+	void skiplist_map<A, B>::for_each(F f) const {
+		epoch::guard hold;
+		for (node* it = strip(head.next[0].load(std::memory_order_acquire)); it != nullptr; it = strip((*it).next[0].load(std::memory_order_acquire))) {
+			const B* value = (*it).value.load(std::memory_order_acquire);
+			if ((value != nullptr) && (value != dead())) {
+				f((*it).key, *value);
+			}
+		}
+	}
+	
+	/**
+	 * \brief This counts the live entries.
+	 * 
+	 * \return Returns the number of entries, it may already be out of date if other threads are writing.
+	 */
+	template <class A, class B>
+	std::size_t skiplist_map<A, B>::size() const {
+		std::size_t total = 0;
+		(*this).for_each([&total](const A&, const B&) { total++; });
+		return total;
+	}
+	
+	/**
+	 * \brief \c overwrite\<B\> merges an update into a value by replacing it, the last write wins.
+	 */
+	template <class B>
+	struct overwrite {
+		/**
+		 * \brief This merges an update into a value.
+		 * 
+		 * \param [in] value is the current value.
+		 * \param [in] update is the update.
+		 * \return Returns \c update.
+		 */
+		B operator() (const B& value, const B& update) const {
+			(void)value;
+			return update;
+		}
+	};
+	
+	/**
+	 * \brief \c sum\<B\> merges an update into a value by adding it, so updates are increments.
+	 */
+	template <class B>
+	struct sum {
+		/**
+		 * \brief This merges an update into a value.
+		 * 
+		 * \param [in] value is the current value.
+		 * \param [in] update is the update.
+		 * \return Returns \c value \c + \c update.
+		 */
+		B operator() (const B& value, const B& update) const {
+			return value + update;
+		}
+	};
+	
+	/**
+	 * \brief The write combining version of \ref map "extended::map<A, B>" for maps that many threads write to.
+	 * 
+	 * \details Each thread collects its \c operator<< updates in its own buffer, merging repeated keys with \c Merge. A buffer is merged into the shared map in one batch once it holds too many keys or is too old, or when \c flush is called. Values that come out as the \c default_value are dropped at that point.
+	 * \details Every read and write checks if any buffer has passed its age, so the updates of a thread that has gone idle or ended are still merged in time. The buffer of a thread that has ended is removed once it has been merged.
+	 * \note Reads only see updates that have been merged into the shared map.
+	 */
+	template <class A, class B, class Merge = overwrite<B>>
+	class combining_map {
+		protected:
+			/**
+			 * \brief The updates of one thread that have not been merged yet.
+			 */
+			struct buffer {
+				std::mutex                            lock;           ///< \c lock is only contended while \c flush or a sweep runs.
+				std::map<A, B>                        pending;        ///< \c pending is the combined updates.
+				std::chrono::steady_clock::time_point started;        ///< \c started is when the oldest pending update was made.
+				bool                                  ended = false;  ///< \c ended is \c true once the thread of the buffer has ended.
+			};
+			
+			/**
+			 * \brief The buffers of the current thread in every map, it marks them as ended when the thread ends.
+			 */
+			struct owner {
+				std::vector<std::pair<uint64_t, std::weak_ptr<buffer>>> mine; ///< \c mine is the buffer of each map by id.
+				
+				~owner() {
+					for (auto& entry : mine) {
+						if (std::shared_ptr<buffer> held = entry.second.lock()) {
+							std::lock_guard<std::mutex> hold((*held).lock);
+							(*held).ended = true;
+						}
+					}
+				}
+			};
+			
+			B                                    default_value = null<B>::value; ///< \c default_value is what stores the values to be ignored, this CANNOT be changed after the constructor to prevent data loss.
+			Merge                                merge;                          ///< \c merge combines an update with a value.
+			map<A, B>                            shared;                         ///< \c shared is the merged map.
+			mutable std::shared_mutex            shared_lock;                    ///< \c shared_lock guards \c shared.
+			std::vector<std::shared_ptr<buffer>> buffers;                        ///< \c buffers is the buffer of every thread that has written.
+			std::mutex                           buffers_lock;                   ///< \c buffers_lock guards \c buffers.
+			std::size_t                          max_keys = 4096;                ///< \c max_keys is how many keys a buffer holds before it is merged.
+			std::chrono::milliseconds            max_age{100};                   ///< \c max_age is how long an update may wait before its buffer is merged.
+			std::atomic<int64_t>                 due{INT64_MAX};                 ///< \c due is the earliest time, in \c steady_clock ticks, that some buffer passes its age.
+			uint64_t                             id;                             ///< \c id tells the buffers of this map apart from those of other maps.
+			
+			static uint64_t next_id();
+			
+			buffer& local();
+			void    drain(buffer&);
+			void    expect(std::chrono::steady_clock::time_point);
+			void    sweep(bool);
+		public:
+			combining_map();
+			combining_map(B);
+			combining_map(B, Merge);
+			combining_map(const combining_map&) = delete;
+			combining_map& operator= (const combining_map&) = delete;
+			
+			B    operator>> (A);
+			void operator<< (std::pair<A, B>);
+			void operator!  ();
+			void flush();
+			void limits(std::size_t, std::chrono::milliseconds);
+	};
+	
+	/**
+	 *  \brief Default constructor
+	 *  
+	 *  \details This default constructor uses the \ref null "extended::null<B>" \c default_value.
+	 */
+	template <class A, class B, class Merge>
+	combining_map<A, B, Merge>::combining_map() : combining_map(null<B>::value, Merge()) {}
+	
+	/**
+	 *  \brief Constructor.
+	 * 
+	 *  \param [in] default_val is the \c default_value for this \c extended::combining_map<A, B, Merge>.
+	 */
+	template <class A, class B, class Merge>
+	combining_map<A, B, Merge>::combining_map(B default_val) : combining_map(default_val, Merge()) {}
+	
+	/**
+	 *  \brief Constructor.
+	 * 
+	 *  \param [in] default_val is the \c default_value for this \c extended::combining_map<A, B, Merge>.
+	 *  \param [in] merger is how an update is combined with a value.
+	 */
+	template <class A, class B, class Merge>
+	combining_map<A, B, Merge>::combining_map(B default_val, Merge merger) : merge(merger), shared(default_val), id(next_id()) {
+		default_value = default_val;
+	}
+	
+	/**
+	 * \brief This gives out a new id for each map.
+	 * 
+	 * \return Returns an id that has not been used before.
+	 */
+	template <class A, class B, class Merge>
+	uint64_t combining_map<A, B, Merge>::next_id() {
+		static std::atomic<uint64_t> ids{0};
+		return ids.fetch_add(1, std::memory_order_relaxed);
+	}
+	
+	/**
+	 * \brief This gets the buffer of the current thread, making it the first time.
+	 * 
+	 * \return Returns the buffer.
+	 */
+	template <class A, class B, class Merge>
+	typename combining_map<A, B, Merge>::buffer& combining_map<A, B, Merge>::local() {
+		static thread_local owner self;
+		auto& mine = self.mine;
+		for (auto& entry : mine) {
+			if (entry.first == id) {
+				return *entry.second.lock();
+			}
+		}
+		mine.erase(std::remove_if(mine.begin(), mine.end(), [](const std::pair<uint64_t, std::weak_ptr<buffer>>& entry) { return entry.second.expired(); }), mine.end());
+		std::shared_ptr<buffer> fresh = std::make_shared<buffer>();
+		{
+			std::lock_guard<std::mutex> hold(buffers_lock);
+			buffers.push_back(fresh);
+		}
+		mine.emplace_back(id, fresh);
+		return *fresh;
+	}
+	
+	/**
+	 * \brief This merges a buffer into the shared map, the caller holds the lock of the buffer.
+	 * 
+	 * \param [in,out] pending is the buffer, it is empty afterwards.
+	 * \return Returns \c void.
+	 * 
+	 * \details The buffer is already sorted, so the current values are read with one \c get_many walk and the results are written back with one \c apply_batch merge, which drops \c default_value results.
+	 */
+	template <class A, class B, class Merge>
+	void combining_map<A, B, Merge>::drain(buffer& pending) {
+		if (pending.pending.empty()) {
+			return;
+		}
+		std::vector<A>               keys;
+		std::vector<std::pair<A, B>> items;
+		for (auto& entry : pending.pending) {
+			keys.push_back(entry.first);
+		}
+		std::vector<B> values(keys.size(), default_value);
+		{
+			std::unique_lock<std::shared_mutex> hold(shared_lock);
+			shared.get_many(keys.begin(), keys.end(), values.begin());
+			std::size_t i = 0;
+			for (auto& entry : pending.pending) {
+				items.emplace_back(entry.first, merge(values[i++], entry.second));
+			}
+			shared.apply_batch(items.begin(), items.end());
+		}
+		pending.pending.clear();
+	}
+	
+	/**
+	 * \brief This notes when a buffer that just got its first pending update must be merged.
+	 * 
+	 * \param [in] started is when that update was made.
+	 * \return Returns \c void.
+	 */
+	template <class A, class B, class Merge>
+	void combining_map<A, B, Merge>::expect(std::chrono::steady_clock::time_point started) {
+		int64_t when    = (int64_t)(started + max_age).time_since_epoch().count();
+		int64_t current = due.load(std::memory_order_relaxed);
+		while ((when < current) && !due.compare_exchange_weak(current, when, std::memory_order_relaxed)) {}
+	}
+	
+	/**
+	 * \brief This merges the buffers that are past their age, or every buffer, and removes the merged buffers of threads that have ended.
+	 * 
+	 * \param [in] all is \c true to merge every buffer, like \c flush .
+	 * \return Returns \c void.
+	 * 
+	 * \details Without \c all it does nothing until \c due has passed, so most reads and writes only pay for one atomic load. Buffers that are being written to are skipped and checked again at the next sweep.
+	 */
+	template <class A, class B, class Merge>
+	void combining_map<A, B, Merge>::sweep(bool all) {
+		auto now = std::chrono::steady_clock::now();
+		if (!all) {
+			int64_t when = due.load(std::memory_order_relaxed);
+			if ((when == INT64_MAX) || (when > (int64_t)now.time_since_epoch().count()) || !due.compare_exchange_strong(when, INT64_MAX, std::memory_order_relaxed)) {
+				return;
+			}
+		}
+		std::vector<std::shared_ptr<buffer>> list;
+		{
+			std::lock_guard<std::mutex> hold(buffers_lock);
+			list = buffers;
+		}
+		std::vector<buffer*> finished;
+		for (auto& pending : list) {
+			std::unique_lock<std::mutex> hold((*pending).lock, std::defer_lock);
+			if (all) {
+				hold.lock();
+			} else if (!hold.try_lock()) {
+				(*this).expect(now);
+				continue;
+			}
+			if (!(*pending).pending.empty()) {
+				if (all || (now - (*pending).started >= max_age)) {
+					(*this).drain(*pending);
+				} else {
+					(*this).expect((*pending).started);
+				}
+			}
+			if ((*pending).ended && (*pending).pending.empty()) {
+				finished.push_back(pending.get());
+			}
+		}
+		if (!finished.empty()) {
+			std::lock_guard<std::mutex> hold(buffers_lock);
+			buffers.erase(std::remove_if(buffers.begin(), buffers.end(), [&finished](const std::shared_ptr<buffer>& entry) { return std::find(finished.begin(), finished.end(), entry.get()) != finished.end(); }), buffers.end());
+		}
+	}
+	
+	/**
+	 * \brief This is the thread safe version of \c extended::map<A, B>::operator>> on the shared map.
+	 * 
+	 * \param [in] input is the location of the desired value.
+	 * \return Returns the merged value of the location if it exists, however, if it does not exist, it will return the \c default_value.
+	 * 
+	 * \details Buffers that are past their age are merged first, which is why this is not \c const .
+	 */
+	template <class A, class B, class Merge>
+	B combining_map<A, B, Merge>::operator>> (A input) {
+		(*this).sweep(false);
+		std::shared_lock<std::shared_mutex> hold(shared_lock);
+		auto it = shared.find(input);
+		if (it != shared.end()) {
+			return (*it).second;
+		}
+		return default_value;
+	}
+	
+	/**
+	 * \brief This adds an update to the buffer of the current thread, merging it into the shared map if the buffer is full or old.
+	 * 
+	 * \param [in] input is the pair of the location and the update.
+	 * \return Returns \c void.
+	 */
+	template <class A, class B, class Merge>
+	void combining_map<A, B, Merge>::operator<< (std::pair<A, B> input) {
+		{
+			buffer& pending = (*this).local();
+			std::lock_guard<std::mutex> hold(pending.lock);
+			auto now = std::chrono::steady_clock::now();
+			if (pending.pending.empty()) {
+				pending.started = now;
+				(*this).expect(now);
+			}
+			auto it = pending.pending.find(input.first);
+			if (it != pending.pending.end()) {
+				(*it).second = merge((*it).second, input.second);
+			} else {
+				pending.pending.emplace(input.first, input.second);
+			}
+			if ((pending.pending.size() >= max_keys) || (now - pending.started >= max_age)) {
+				(*this).drain(pending);
+			}
+		}
+		(*this).sweep(false);
+	}
+	
+	/**
+	 * \brief This merges every buffer and removes any \c default_value from the shared map.
+	 * 
+	 * \return Returns \c void.
+	 */
+	template <class A, class B, class Merge>
+	void combining_map<A, B, Merge>::operator! () {
+		(*this).flush();
+		std::unique_lock<std::shared_mutex> hold(shared_lock);
+		!shared;
+	}
+	
+	/**
+	 * \brief This merges the buffer of every thread into the shared map.
+	 * 
+	 * \return Returns \c void.
+	 * 
+	 * \details The buffers of threads that have ended are removed afterwards.
+	 */
+	template <class A, class B, class Merge>
+	void combining_map<A, B, Merge>::flush() {
+		(*this).sweep(true);
+	}
+	
+	/**
+	 * \brief This sets when a buffer is merged into the shared map.
+	 * 
+	 * \param [in] keys is how many keys a buffer may hold.
+	 * \param [in] age is how long an update may wait, it is checked on every read and write of the map.
+	 * \return Returns \c void.
+	 * 
+	 * \note Call this before other threads start writing.
+	 */
+	template <class A, class B, class Merge>
+	void combining_map<A, B, Merge>::limits(std::size_t keys, std::chrono::milliseconds age) {
+		max_keys = keys;
+		max_age  = age;
+	}
+	
+	/**
+	 * \brief The counting version of \ref map "extended::map<A, B>".
+	 * 
+	 * \details \c add changes a count with a single search of the map, and erases the entry as soon as the count is back to the \c default_value, so only keys with a count take up memory.
+	 */
+	template <class A, class B = int64_t>
+	class counter_map : public map<A, B> {
+		public:
+			using map<A, B>::map;
+			
+			B add(A, B);
+	};
+	
+	/**
+	 * \brief This adds to the count of a key.
+	 * 
+	 * \param [in] key is the key.
+	 * \param [in] delta is the amount to add, it may be negative.
+	 * \return Returns the new count.
+	 * 
+	 * \details The position of the key is found once and then used to update, insert, or erase the entry.
+	 */
+	template <class A, class B>
+	B counter_map<A, B>::add(A key, B delta) {
+		auto it = (*this).lower_bound(key);
+		if ((it != (*this).end()) && !(*this).key_comp()(key, (*it).first)) {
+			(*it).second += delta;
+			B out = (*it).second;
+			if (out == (*this).default_value) {
+				(*this).erase(it);
+			}
+			return out;
+		}
+		B out = (*this).default_value + delta;
+		if (out != (*this).default_value) {
+			(*this).emplace_hint(it, key, out);
+			(*this).note_key(key);
+		}
+		return out;
+	}
+	
+	/**
+	 * \brief The thread safe version of \ref counter_map "extended::counter_map<A, B>".
+	 * 
+	 * \details Keys are split across shards like \ref concurrent_map "extended::concurrent_map<A, B>", and each count is atomic. Adding to a key that already has an entry only takes the lock of its shard as a reader, so many threads can count at once. A count that goes back to the \c default_value keeps its entry until \c operator! erases it.
+	 * \note \c B must be an arithmetic type.
+	 */
+	template <class A, class B = int64_t>
+	class concurrent_counter_map {
+		static_assert(std::is_arithmetic<B>::value, "extended::concurrent_counter_map needs an arithmetic count type");
+		protected:
+			/**
+			 * \brief One part of the keys with its own lock, each is kept on its own cache line.
+			 */
+			struct alignas(64) shard {
+				mutable std::shared_mutex       lock; ///< \c lock is shared by readers and by \c add on existing keys, held alone to insert or erase.
+				std::map<A, std::atomic<B>>     data; ///< \c data is the counts of this shard.
+			};
+			
+			B                                   default_value = null<B>::value; ///< \c default_value is the count of a key with no entry, this CANNOT be changed after the constructor to prevent data loss.
+			std::vector<std::unique_ptr<shard>> shards;                        ///< \c shards is the parts of the map, this CANNOT be changed after the constructor.
+			
+			static B    bump(std::atomic<B>&, B);
+			std::size_t shard_of(const A&) const;
+		public:
+			concurrent_counter_map();
+			concurrent_counter_map(B);
+			concurrent_counter_map(B, std::size_t);
+			
+			B    operator>> (A) const;
+			B    add(A, B);
+			void operator!  ();
+			
+			std::size_t size() const;
+	};
+	
+	/**
+	 *  \brief Default constructor
+	 *  
+	 *  \details This default constructor makes 16 shards using the \ref null "extended::null<B>" \c default_value.
+	 */
+	template <class A, class B>
+	concurrent_counter_map<A, B>::concurrent_counter_map() : concurrent_counter_map(null<B>::value, 16) {}
+	
+	/**
+	 *  \brief Constructor.
+	 * 
+	 *  \param [in] default_val is the \c default_value for this \c extended::concurrent_counter_map<A, B>.
+	 * 
+	 *  \details This constructor makes 16 shards and sets \c default_value to \c default_val.
+	 */
+	template <class A, class B>
+	concurrent_counter_map<A, B>::concurrent_counter_map(B default_val) : concurrent_counter_map(default_val, 16) {}
+	
+	/**
+	 *  \brief Constructor.
+	 * 
+	 *  \param [in] default_val is the \c default_value for this \c extended::concurrent_counter_map<A, B>.
+	 *  \param [in] count is the number of shards, it is raised to 1 if it is 0.
+	 * 
+	 *  \details This constructor makes \c count shards and sets \c default_value to \c default_val.
+	 */
+	template <class A, class B>
+	concurrent_counter_map<A, B>::concurrent_counter_map(B default_val, std::size_t count) {
+		default_value = default_val;
+		if (count == 0) {
+			count = 1;
+		}
+		for (std::size_t i = 0; i < count; i++) {
+			shards.emplace_back(new shard());
+		}
+	}
+	
+	/**
+	 * \brief This adds to an atomic count.
+	 * 
+	 * \param [in,out] count is the count.
+	 * \param [in] delta is the amount to add.
+	 * \return Returns the new count.
+	 */
+	template <class A, class B>
+	B concurrent_counter_map<A, B>::bump(std::atomic<B>& count, B delta) {
+		if constexpr (std::is_integral<B>::value) {
+			return count.fetch_add(delta, std::memory_order_relaxed) + delta;
+		} else {
+			B old = count.load(std::memory_order_relaxed);
+			while (!count.compare_exchange_weak(old, old + delta, std::memory_order_relaxed)) {}
+			return old + delta;
+		}
+	}
+	
+	/**
+	 * \brief This picks the shard a key belongs to.
+	 * 
+	 * \param [in] key is the key.
+	 * \return Returns the index of the shard.
+	 */
+	template <class A, class B>
+	std::size_t concurrent_counter_map<A, B>::shard_of(const A& key) const {
+		if constexpr (hashable<A>::value) {
+			uint64_t h = (uint64_t)std::hash<A>()(key) * 0x9e3779b97f4a7c15ULL;
+			return (std::size_t)((h >> 32) % shards.size());
+		} else {
+			return 0;
+		}
+	}
+	
+	/**
+	 * \brief This is the thread safe version of \c extended::map<A, B>::operator>> .
+	 * 
+	 * \param [in] input is the key.
+	 * \return Returns the count of the key, or the \c default_value if it has none.
+	 */
+	template <class A, class B>
+	B concurrent_counter_map<A, B>::operator>> (A input) const {
+		const shard& part = *shards[(*this).shard_of(input)];
+		std::shared_lock<std::shared_mutex> hold(part.lock);
+		auto it = part.data.find(input);
+		if (it != part.data.end()) {
+			return (*it).second.load(std::memory_order_relaxed);
+		}
+		return default_value;
+	}
+	
+	/**
+	 * \brief This adds to the count of a key.
+	 * 
+	 * \param [in] key is the key.
+	 * \param [in] delta is the amount to add, it may be negative.
+	 * \return Returns the new count.
+	 * 
+	 * \details If the key has an entry the count is changed atomically under the shared lock of its shard, otherwise the shard is locked alone to insert it.
+	 */
+	template <class A, class B>
+	B concurrent_counter_map<A, B>::add(A key, B delta) {
+		shard& part = *shards[(*this).shard_of(key)];
+		{
+			std::shared_lock<std::shared_mutex> hold(part.lock);
+			auto it = part.data.find(key);
+			if (it != part.data.end()) {
+				return bump((*it).second, delta);
+			}
+		}
+		std::unique_lock<std::shared_mutex> hold(part.lock);
+		auto it = part.data.lower_bound(key);
+		if ((it == part.data.end()) || part.data.key_comp()(key, (*it).first)) {
+			if (default_value + delta == default_value) {
+				return default_value;
+			}
+			it = part.data.emplace_hint(it, std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(default_value));
+		}
+		return bump((*it).second, delta);
+	}
+	
+	/**
+	 * \brief This erases every count that is back to the \c default_value, one shard at a time.
+	 * 
+	 * \return Returns \c void.
+	 */
+	template <class A, class B>
+	void concurrent_counter_map<A, B>::operator! () {
+		for (auto& part : shards) {
+			std::unique_lock<std::shared_mutex> hold((*part).lock);
+			for (auto it = (*part).data.begin(); it != (*part).data.end(); ) {
+				if ((*it).second.load(std::memory_order_relaxed) == default_value) {
+					it = (*part).data.erase(it);
+				} else {
+					std::advance(it, 1);
+				}
+			}
+		}
+	}
+	
+	/**
+	 * \brief This counts the entries in every shard, including counts that are back to the \c default_value but not yet erased.
+	 * 
+	 * \return Returns the number of entries, it may already be out of date if other threads are writing.
+	 */
+	template <class A, class B>
+	std::size_t concurrent_counter_map<A, B>::size() const {
+		std::size_t total = 0;
+		for (auto& part : shards) {
+			std::shared_lock<std::shared_mutex> hold((*part).lock);
+			total += (*part).data.size();
+		}
+		return total;
+	}
+	
+	/**
+	 * \brief How the reads of an \ref async_map "extended::async_map<A, B>" see queued writes.
+	 */
+	enum class consistency {
+		read_your_writes, ///< \c read_your_writes makes a read wait until the writes its thread queued before it have been applied.
+		eventual          ///< \c eventual reads whatever has been applied, without waiting.
+	};
+	
+	/**
+	 * \brief The asynchronous version of \ref map "extended::map<A, B>" for writers that must not wait on the map.
+	 * 
+	 * \details Writes go into a bounded queue that many threads may push to without a lock, and a thread owned by the map takes them off in batches and applies them, runs of \c operator<< writes with one \c apply_batch. A write gives a \c std::future, or calls a callback, once it can be read.
+	 * \details If applying a write throws, for example while copying or comparing a value, the error is given to that write's future or callback and the applier carries on with the next write.
+	 * \note Callbacks run on the applier thread after the batch is visible, they must be quick and must not write to the same map and wait for it. An exception thrown by a callback is dropped.
+	 * \note Moving \c A and \c B must not throw, since a write is moved into the queue after its place has been claimed.
+	 */
+	template <class A, class B>
+	class async_map {
+		static_assert(std::is_nothrow_move_constructible<std::pair<A, B>>::value, "extended::async_map needs A and B to be nothrow move constructible");
+		protected:
+			/**
+			 * \brief One queued write.
+			 */
+			struct update {
+				std::pair<A, B>                           item; ///< \c item is the pair of the location and the desired value.
+				bool                                      keep; ///< \c keep is \c true for \c operator() writes, which do not erase on the \c default_value.
+				std::function<void(std::exception_ptr)> done; ///< \c done is called once the write is visible, with the error if it failed, it may be empty.
+			};
+			
+			/**
+			 * \brief The ids of the maps that are alive, so that threads can drop the tickets of maps that are gone.
+			 */
+			struct registry {
+				std::mutex         lock; ///< \c lock guards \c ids.
+				std::set<uint64_t> ids;  ///< \c ids is the id of every live map.
+			};
+			
+			/**
+			 * \brief One place in the queue, its sequence says whether it is free or filled for the current lap.
+			 */
+			struct cell {
+				std::atomic<uint64_t>  sequence; ///< \c sequence is the position the cell is free for, or one past the position it was filled for.
+				std::optional<update>  value;    ///< \c value is the queued write.
+			};
+			
+			B                           default_value = null<B>::value; ///< \c default_value is what stores the values to be ignored, this CANNOT be changed after the constructor to prevent data loss.
+			map<A, B>                   data;                           ///< \c data is the applied map.
+			mutable std::shared_mutex   data_lock;                      ///< \c data_lock guards \c data.
+			std::unique_ptr<cell[]>     cells;                          ///< \c cells is the ring of the queue.
+			uint64_t                    mask;                           ///< \c mask is the number of cells less one.
+			alignas(64) std::atomic<uint64_t> tail{0};                  ///< \c tail is the next position to write, it is also the ticket of the last write queued.
+			alignas(64) uint64_t        head = 0;                       ///< \c head is the next position the applier reads, only it uses this.
+			alignas(64) std::atomic<uint64_t> applied{0};               ///< \c applied is the ticket of the last write that is visible.
+			std::atomic<consistency>    mode;                           ///< \c mode is how reads see queued writes.
+			mutable std::mutex          wait_lock;                      ///< \c wait_lock is used with the condition variables.
+			std::condition_variable     work;                           ///< \c work wakes the applier.
+			mutable std::condition_variable visible;                    ///< \c visible wakes threads waiting for writes to apply, or for room in the queue.
+			std::atomic<bool>           sleeping{false};                ///< \c sleeping is \c true while the applier waits for work.
+			std::atomic<bool>           stopping{false};                ///< \c stopping is \c true once the map is being destroyed.
+			uint64_t                    id;                             ///< \c id tells the tickets of this map apart from those of other maps.
+			std::thread                 applier;                        ///< \c applier is the thread that applies the queue.
+			
+			static uint64_t                                next_id();
+			static registry&                               live();
+			static std::unordered_map<uint64_t, uint64_t>& tickets();
+			
+			uint64_t& last_ticket() const;
+			bool      push(update&);
+			void      enqueue(update);
+			void      wait_visible(uint64_t) const;
+			void      apply();
+		public:
+			async_map();
+			async_map(B);
+			async_map(B, std::size_t, consistency = consistency::read_your_writes);
+			async_map(const async_map&) = delete;
+			async_map& operator= (const async_map&) = delete;
+			~async_map();
+			
+			B                 operator>> (A) const;
+			std::future<void> operator() (std::pair<A, B>);
+			std::future<void> operator<< (std::pair<A, B>);
+			void              operator!  ();
+			void              write(std::pair<A, B>, std::function<void(std::exception_ptr)>);
+			bool              try_write(std::pair<A, B>, std::function<void(std::exception_ptr)> = {});
+			void              flush() const;
+			void              reads(consistency);
+	};
+	
+	/**
+	 *  \brief Default constructor
+	 *  
+	 *  \details This default constructor makes a queue of 4096 writes with \c consistency::read_your_writes using the \ref null "extended::null<B>" \c default_value.
+	 */
+	template <class A, class B>
+	async_map<A, B>::async_map() : async_map(null<B>::value, 4096) {}
+	
+	/**
+	 *  \brief Constructor.
+	 * 
+	 *  \param [in] default_val is the \c default_value for this \c extended::async_map<A, B>.
+	 * 
+	 *  \details This constructor makes a queue of 4096 writes with \c consistency::read_your_writes and sets \c default_value to \c default_val.
+	 */
+	template <class A, class B>
+	async_map<A, B>::async_map(B default_val) : async_map(default_val, 4096) {}
+	
+	/**
+	 *  \brief Constructor.
+	 * 
+	 *  \param [in] default_val is the \c default_value for this \c extended::async_map<A, B>.
+	 *  \param [in] capacity is the most writes the queue holds, it is rounded up to a power of two.
+	 *  \param [in] how is how reads see queued writes.
+	 * 
+	 *  \details This constructor starts the applier thread.
+	 */
+	template <class A, class B>
+	async_map<A, B>::async_map(B default_val, std::size_t capacity, consistency how) : data(default_val), mode(how), id(next_id()) {
+		default_value = default_val;
+		std::size_t size = 2;
+		while (size < capacity) {
+			size *= 2;
+		}
+		cells.reset(new cell[size]);
+		for (std::size_t i = 0; i < size; i++) {
+			cells[i].sequence.store(i, std::memory_order_relaxed);
+		}
+		mask    = size - 1;
+		{
+			std::lock_guard<std::mutex> hold(live().lock);
+			live().ids.insert(id);
+		}
+		applier = std::thread(&async_map::apply, this);
+	}
+	
+	/**
+	 *  \brief Destructor.
+	 *  
+	 *  \details This applies every queued write and then stops the applier thread, no other thread may still be writing. The ticket of the calling thread is dropped now, other threads drop theirs the next time they use a map they have not used before.
+	 */
+	template <class A, class B>
+	async_map<A, B>::~async_map() {
+		{
+			std::lock_guard<std::mutex> hold(wait_lock);
+			stopping.store(true);
+		}
+		work.notify_one();
+		applier.join();
+		{
+			std::lock_guard<std::mutex> hold(live().lock);
+			live().ids.erase(id);
+		}
+		tickets().erase(id);
+	}
+	
+	/**
+	 * \brief This gives out a new id for each map.
+	 * 
+	 * \return Returns an id that has not been used before.
+	 */
+	template <class A, class B>
+	uint64_t async_map<A, B>::next_id() {
+		static std::atomic<uint64_t> ids{0};
+		return ids.fetch_add(1, std::memory_order_relaxed);
+	}
+	
+	/**
+	 * \brief This gets the ids of the maps that are alive.
 	 * 
-	 * \details This class uses \ref null "extended::null<A>" to define a \c default_value for the \c std::map<A, B> unless it is changed in the constructor, then, it does not save items equal to the \c default_value and all values that are not defined will be defined as the \c default_value.
-	 * \note All of the \c map<A, B> operators and functions are left unchanged, so there will not be any conflicts, however, many operations will use new operators to make use of this class.
-	 * \note A version of this class exists solely because \c std::string does not work like other objects, if you are using this code as a base for an application that acts like \c std::string, I would suggest making a version of the class to suit your needs better.
+	 * \return Returns the registry.
 	 */
 	template <class A, class B>
-	class map : public std::map<A, B> {
-		protected:
-			B default_value = null<B>::value; ///< \c default_value is what stores the values to be ignored, this CANNOT be changed after the constructor to prevent data loss.
-		public:
-			map();
-			map(B);
-			template<class... Args> map(B, Args...);
-			
-			B    operator>> (A);
-			void operator() (std::pair<A, B>);
-			void operator<< (std::pair<A, B>);
-			void operator!  ();
-	};
+	typename async_map<A, B>::registry& async_map<A, B>::live() {
+		static registry maps;
+		return maps;
+	}
+	
 	/**
-	 * \brief The memory saving version of \c std::map<A, std::string>.
+	 * \brief This gets the tickets of the current thread, by map id.
 	 * 
-	 * \details This class uses \ref null "extended::null<A>" to define a \c default_value for the \c std::map<A, std::string> unless it is changed in the constructor, then, it does not save items equal to the \c default_value and all values that are not defined will be defined as the \c default_value.
-	 * \note All of the \c map<A, std::string> operators and functions are left unchanged, so there will not be any conflicts, however, many operations will use new operators to make use of this class.
-	 * \note This version exists solely because \c std::string does not work like other objects, if you are using this code as a base for an application that acts like \c std::string, I would suggest making a version of the class to suit your needs better.
+	 * \return Returns the tickets.
 	 */
-	template <class A>
-	class map <A, std::string> : public std::map<A, std::string> {
-		protected:
-			std::string default_value = null<std::string>::value; ///< \c default_value is what stores the values to be ignored, this CANNOT be changed after the constructor to prevent data loss.
-		public:
-			map();
-			map(std::string);
-			template<class... Args> map(std::string, Args...);
-			
-			std::string operator>> (A);
-			void        operator() (std::pair<A, std::string>);
-			void        operator<< (std::pair<A, std::string>);
-			void        operator!  ();
-	};
+	template <class A, class B>
+	std::unordered_map<uint64_t, uint64_t>& async_map<A, B>::tickets() {
+		static thread_local std::unordered_map<uint64_t, uint64_t> mine;
+		return mine;
+	}
 	
 	/**
-	 *  \brief Default constructor
-	 *  
-	 *  \details This default constructor does nothing except call the \c std::map<A, B> default constructor
+	 * \brief This gets the ticket of the last write the current thread queued on this map.
+	 * 
+	 * \return Returns the ticket, it is \c 0 if the thread has not written.
 	 */
 	template <class A, class B>
-	map<A, B>::map() : std::map<A, B>() {}
+	uint64_t& async_map<A, B>::last_ticket() const {
+		std::unordered_map<uint64_t, uint64_t>& mine = tickets();
+		auto found = mine.find(id);
+		if (found != mine.end()) {
+			return (*found).second;
+		}
+		{
+			std::lock_guard<std::mutex> hold(live().lock);
+			for (auto it = mine.begin(); it != mine.end(); ) {
+				if (live().ids.count((*it).first) == 0) {
+					it = mine.erase(it);
+				} else {
+					std::advance(it, 1);
+				}
+			}
+		}
+		return mine[id];
+	}
 	
 	/**
-	 *  \brief Constructor.
+	 * \brief This tries to put a write in the queue without waiting.
 	 * 
-	 *  \param [in] default_val is the \c default_value for this \c extended::map<A, B>.
+	 * \param [in,out] next is the write, it is moved from if it was queued.
+	 * \return Returns \c false if the queue is full.
 	 * 
-	 *  \details This constructor calls the \c std::map<A, B> default constructor and sets \c default_value to \c default_val.
+	 * \details A writer claims a position by moving \c tail on, fills the cell, and then sets its sequence so the applier can take it. A cell whose sequence is behind the position is still waiting to be applied from the last lap.
+	 * \details Filling the cell only moves \c next, which cannot throw, so a claimed cell is always published and the applier never waits on it forever.
 	 */
 	template <class A, class B>
-	map<A, B>::map(B default_val) : std::map<A, B>() {
-		default_value = default_val;
+	bool async_map<A, B>::push(update& next) {
+		uint64_t pos = tail.load(std::memory_order_relaxed);
+		while (true) {
+			cell&    place = cells[pos & mask];
+			uint64_t seq   = place.sequence.load(std::memory_order_acquire);
+			if (seq == pos) {
+				if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+					place.value.emplace(std::move(next));
+					place.sequence.store(pos + 1, std::memory_order_release);
+					(*this).last_ticket() = pos + 1;
+					std::atomic_thread_fence(std::memory_order_seq_cst);
+					if (sleeping.load(std::memory_order_relaxed)) {
+						std::lock_guard<std::mutex> hold(wait_lock);
+						work.notify_one();
+					}
+					return true;
+				}
+			} else if (seq < pos) {
+				return false;
+			} else {
+				pos = tail.load(std::memory_order_relaxed);
+			}
+		}
 	}
 	
 	/**
-	 * \brief Constructor.
+	 * \brief This puts a write in the queue, waiting for room if it is full.
 	 * 
-	 * \param [in] default_val is the \c default_value for this \c extended::map<A, B>.
-	 * \param [in] args are the arguments to be sent to the \c std::map<A, B> default constructor
+	 * \param [in] next is the write.
+	 * \return Returns \c void.
 	 * 
-	 * \details This constructor calls the \c std::map<A, B> constructor, while passing \c args to it and sets \c default_value to \c default_val.
+	 * \details While the queue is full the writer waits on \c visible for the cell at \c tail to be freed, the applier notifies it each time it takes a batch off the queue.
 	 */
 	template <class A, class B>
-	template <class... Args>
-	map<A, B>::map(B default_val, Args... args) : std::map<A, B>(args...) {
-		default_value = default_val;
+	void async_map<A, B>::enqueue(update next) {
+		while (!(*this).push(next)) {
+			std::unique_lock<std::mutex> hold(wait_lock);
+			uint64_t pos = tail.load(std::memory_order_relaxed);
+			visible.wait(hold, [this, pos]() { return cells[pos & mask].sequence.load(std::memory_order_acquire) >= pos; });
+		}
 	}
 	
+	/**
+	 * \brief This waits until a write is visible.
+	 * 
+	 * \param [in] ticket is the ticket of the write.
+	 * \return Returns \c void.
+	 */
+	template <class A, class B>
+	void async_map<A, B>::wait_visible(uint64_t ticket) const {
+		if (applied.load(std::memory_order_acquire) >= ticket) {
+			return;
+		}
+		std::unique_lock<std::mutex> hold(wait_lock);
+		visible.wait(hold, [this, ticket]() { return applied.load(std::memory_order_acquire) >= ticket; });
+	}
 	
+	/**
+	 * \brief This is the loop of the applier thread, it applies the queue in batches until the map is destroyed.
+	 * 
+	 * \return Returns \c void.
+	 * 
+	 * \details Every write that is ready is taken off the queue at once. Runs of \c operator<< writes are merged with one \c apply_batch, \c operator() writes are applied one at a time to keep their order, and the map is locked once for the whole batch. The callbacks run once the batch is visible.
+	 * \details If a run throws, its writes are applied again one at a time so that each error reaches only the write that caused it. Writing the same values twice leaves the map the same as writing them once. A write that throws while it is taken off the queue is not applied and gets its error the same way.
+	 */
+	template <class A, class B>
+	void async_map<A, B>::apply() {
+		std::vector<update>          batch;
+		std::vector<std::pair<A, B>> run;
+		std::vector<std::pair<std::function<void(std::exception_ptr)>, std::exception_ptr>> lost;
+		batch.reserve(mask + 1);
+		while (true) {
+			batch.clear();
+			lost.clear();
+			while (true) {
+				cell& place = cells[head & mask];
+				if (place.sequence.load(std::memory_order_acquire) != head + 1) {
+					break;
+				}
+				try {
+					batch.push_back(std::move(*place.value));
+				} catch (...) {
+					lost.emplace_back(std::move((*place.value).done), std::current_exception());
+				}
+				place.value.reset();
+				place.sequence.store(head + mask + 1, std::memory_order_release);
+				head++;
+			}
+			if (!batch.empty() || !lost.empty()) {
+				{
+					std::lock_guard<std::mutex> hold(wait_lock);
+				}
+				visible.notify_all();
+			}
+			if (batch.empty() && lost.empty()) {
+				std::unique_lock<std::mutex> hold(wait_lock);
+				if (stopping.load()) {
+					return;
+				}
+				sleeping.store(true, std::memory_order_relaxed);
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				if (cells[head & mask].sequence.load(std::memory_order_relaxed) != head + 1) {
+					work.wait_for(hold, std::chrono::milliseconds(10));
+				}
+				sleeping.store(false, std::memory_order_relaxed);
+				continue;
+			}
+			std::vector<std::exception_ptr> errors(batch.size());
+			try {
+				std::unique_lock<std::shared_mutex> hold(data_lock);
+				std::size_t start = 0;
+				auto merge_run = [&](std::size_t end) {
+					try {
+						data.apply_batch(run.begin(), run.end());
+					} catch (...) {
+						for (std::size_t i = start; i < end; i++) {
+							try {
+								data << run[i - start];
+							} catch (...) {
+								errors[i] = std::current_exception();
+							}
+						}
+					}
+					run.clear();
+				};
+				for (std::size_t i = 0; i < batch.size(); i++) {
+					if (!batch[i].keep) {
+						run.push_back(std::move(batch[i].item));
+						continue;
+					}
+					merge_run(i);
+					start = i + 1;
+					try {
+						data(std::move(batch[i].item));
+					} catch (...) {
+						errors[i] = std::current_exception();
+					}
+				}
+				merge_run(batch.size());
+			} catch (...) {
+				run.clear();
+				for (auto& error : errors) {
+					if (!error) {
+						error = std::current_exception();
+					}
+				}
+			}
+			{
+				std::lock_guard<std::mutex> hold(wait_lock);
+				applied.store(head, std::memory_order_release);
+			}
+			visible.notify_all();
+			for (std::size_t i = 0; i < batch.size(); i++) {
+				if (batch[i].done) {
+					try {
+						batch[i].done(errors[i]);
+					} catch (...) {}
+				}
+			}
+			for (auto& failed : lost) {
+				if (failed.first) {
+					try {
+						failed.first(failed.second);
+					} catch (...) {}
+				}
+			}
+		}
+	}
 	
 	/**
-	 * \brief This adds a read only \c operator[] using \c operator>> to "pull" out the value.
+	 * \brief This is the thread safe version of \c extended::map<A, B>::operator>> .
 	 * 
 	 * \param [in] input is the location of the desired value.
 	 * \return Returns the value of the location if it exists, however, if it does not exist, it will return the \c default_value.
+	 * 
+	 * \details With \c consistency::read_your_writes this first waits until every write the calling thread queued has been applied.
 	 */
 	template <class A, class B>
-	B map<A, B>::operator>> (A input) {
-		if ((*this).count(input) > 0) {
-			return (*this).operator[](input);
+	B async_map<A, B>::operator>> (A input) const {
+		if (mode.load(std::memory_order_relaxed) == consistency::read_your_writes) {
+			(*this).wait_visible((*this).last_ticket());
+		}
+		std::shared_lock<std::shared_mutex> hold(data_lock);
+		auto it = data.find(input);
+		if (it != data.end()) {
+			return (*it).second;
 		}
 		return default_value;
 	}
 	
 	/**
-	 * \brief This adds a pair to the map if and only if the first value is already in use or the second value is not the \c default_value.
+	 * \brief This queues \c extended::map<A, B>::operator() .
+	 * 
+	 * \param [in] input is the pair of the location and the desired value.
+	 * \return Returns a future that is ready once the write is visible, it holds the error if applying the write threw.
+	 */
+	template <class A, class B>
+	std::future<void> async_map<A, B>::operator() (std::pair<A, B> input) {
+		auto promise = std::make_shared<std::promise<void>>();
+		std::future<void> ready = (*promise).get_future();
+		(*this).enqueue(update{std::move(input), true, [promise](std::exception_ptr error) {
+			if (error) {
+				(*promise).set_exception(error);
+			} else {
+				(*promise).set_value();
+			}
+		}});
+		return ready;
+	}
+	
+	/**
+	 * \brief This queues \c extended::map<A, B>::operator<< .
+	 * 
+	 * \param [in] input is the pair of the location and the desired value.
+	 * \return Returns a future that is ready once the write is visible, it holds the error if applying the write threw.
+	 */
+	template <class A, class B>
+	std::future<void> async_map<A, B>::operator<< (std::pair<A, B> input) {
+		auto promise = std::make_shared<std::promise<void>>();
+		std::future<void> ready = (*promise).get_future();
+		(*this).enqueue(update{std::move(input), false, [promise](std::exception_ptr error) {
+			if (error) {
+				(*promise).set_exception(error);
+			} else {
+				(*promise).set_value();
+			}
+		}});
+		return ready;
+	}
+	
+	/**
+	 * \brief This applies every write queued so far and removes any \c default_value from the map.
+	 * 
+	 * \return Returns \c void.
+	 */
+	template <class A, class B>
+	void async_map<A, B>::operator! () {
+		(*this).flush();
+		std::unique_lock<std::shared_mutex> hold(data_lock);
+		!data;
+	}
+	
+	/**
+	 * \brief This queues \c extended::map<A, B>::operator<< with a callback instead of a future, waiting for room if the queue is full.
 	 * 
 	 * \param [in] input is the pair of the location and the desired value.
+	 * \param [in] done is called on the applier thread once the write is visible, with \c nullptr or the error if applying the write threw, it may be empty.
 	 * \return Returns \c void.
 	 */
 	template <class A, class B>
-	void map<A, B>::operator() (std::pair<A, B> input) {
-		if (((*this).count(input.first) > 0) || (input.second != default_value)) {
-			(*this).operator[](input.first) = input.second;
-		}
+	void async_map<A, B>::write(std::pair<A, B> input, std::function<void(std::exception_ptr)> done) {
+		(*this).enqueue(update{std::move(input), false, std::move(done)});
 	}
 	
 	/**
-	 * \brief This adds a pair to the map if and only if the second value is not the \c default_value, if it is \c default_value, then it will also erase the entry.
+	 * \brief This queues \c extended::map<A, B>::operator<< only if there is room, it never waits.
 	 * 
 	 * \param [in] input is the pair of the location and the desired value.
+	 * \param [in] done is called on the applier thread once the write is visible, with \c nullptr or the error if applying the write threw, it may be empty.
+	 * \return Returns \c false if the queue was full and nothing was queued.
+	 */
+	template <class A, class B>
+	bool async_map<A, B>::try_write(std::pair<A, B> input, std::function<void(std::exception_ptr)> done) {
+		update next{std::move(input), false, std::move(done)};
+		return (*this).push(next);
+	}
+	
+	/**
+	 * \brief This waits until every write queued before it, by any thread, is visible.
+	 * 
 	 * \return Returns \c void.
 	 */
 	template <class A, class B>
-	void map<A, B>::operator<< (std::pair<A, B> input) {
-		if (input.second != default_value) {
-			(*this).operator[](input.first) = input.second;
-		} else if ((*this).count(input.first) > 0) {
-			auto it = (*this).begin();
-			it = (*this).find(input.first);
-			(*this).erase(it);
+	void async_map<A, B>::flush() const {
+		(*this).wait_visible(tail.load(std::memory_order_acquire));
+	}
+	
+	/**
+	 * \brief This sets how reads see queued writes.
+	 * 
+	 * \param [in] how is the new mode.
+	 * \return Returns \c void.
+	 */
+	template <class A, class B>
+	void async_map<A, B>::reads(consistency how) {
+		mode.store(how, std::memory_order_relaxed);
+	}
+	
+	/**
+	 * \brief The multi-version version of \ref map "extended::map<A, B>" for long reads that run alongside writers.
+	 * 
+	 * \details Each key keeps a short chain of the values it has had, each stamped with the time it was written. \c snapshot pins a time, and the snapshot reads the newest value of each key that is not newer than that time, so a scan sees one consistent state however long it takes. Scans only lock the map for a few hundred entries at a time, so writers wait at most that long. Versions that no snapshot can see any more are dropped by \c operator!, which also erases keys whose only version left is the \c default_value.
+	 */
+	template <class A, class B>
+	class mvcc_map {
+		protected:
+			/**
+			 * \brief One value of a key and when it was written.
+			 */
+			struct version {
+				uint64_t stamp; ///< \c stamp is the time the value was written.
+				B        value; ///< \c value is the value, the \c default_value marks the key as erased.
+			};
+			
+			B                                     default_value = null<B>::value; ///< \c default_value is what stores the values to be ignored, this CANNOT be changed after the constructor to prevent data loss.
+			std::map<A, std::vector<version>>     data;                           ///< \c data is the version chain of each key, oldest first.
+			mutable std::shared_mutex             data_lock;                      ///< \c data_lock guards \c data.
+			std::atomic<uint64_t>                 clock{0};                       ///< \c clock is the time of the last write.
+			mutable std::mutex                    pinned_lock;                    ///< \c pinned_lock guards \c pinned.
+			mutable std::multiset<uint64_t>       pinned;                         ///< \c pinned is the time of every live snapshot.
+			
+			static const std::size_t scan_step = 256; ///< \c scan_step is how many entries a scan reads under one lock.
+			
+			const B& visible(const std::vector<version>&, uint64_t) const;
+			uint64_t oldest() const;
+			void     write(const std::pair<A, B>&, bool);
+		public:
+			/**
+			 * \brief A read view of the map as it was at one time, it stays the same while writers carry on.
+			 * 
+			 * \note The map must outlive the snapshot. Old versions are kept until the snapshot is destroyed, so it should not be kept longer than it is needed.
+			 */
+			class snapshot {
+				protected:
+					const mvcc_map* owner; ///< \c owner is the map.
+					uint64_t        stamp; ///< \c stamp is the time the snapshot reads at.
+				public:
+					snapshot(const mvcc_map*, uint64_t);
+					snapshot(snapshot&&) noexcept;
+					snapshot& operator= (snapshot&&) = delete;
+					~snapshot();
+					
+					B                    operator>> (A) const;
+					template<class F> void for_each(F) const;
+					uint64_t             time() const;
+			};
+			
+			mvcc_map();
+			mvcc_map(B);
+			mvcc_map(const mvcc_map&) = delete;
+			mvcc_map& operator= (const mvcc_map&) = delete;
+			
+			B        operator>> (A) const;
+			void     operator() (std::pair<A, B>);
+			void     operator<< (std::pair<A, B>);
+			void     operator!  ();
+			snapshot pin() const;
+			
+			std::size_t size() const;
+	};
+	
+	/**
+	 *  \brief Constructor.
+	 * 
+	 *  \param [in] from is the map, the caller has already added \c time to its pinned times.
+	 *  \param [in] time is the time to read at.
+	 */
+	template <class A, class B>
+	mvcc_map<A, B>::snapshot::snapshot(const mvcc_map* from, uint64_t time) : owner(from), stamp(time) {}
+	
+	/**
+	 *  \brief Move constructor.
+	 * 
+	 *  \param [in] other is the snapshot to take the pinned time from.
+	 */
+	template <class A, class B>
+	mvcc_map<A, B>::snapshot::snapshot(snapshot&& other) noexcept : owner(std::exchange(other.owner, nullptr)), stamp(other.stamp) {}
+	
+	/**
+	 *  \brief Destructor.
+	 *  
+	 *  \details This unpins the time so \c operator! may drop the versions only this snapshot could see.
+	 */
+	template <class A, class B>
+	mvcc_map<A, B>::snapshot::~snapshot() {
+		if (owner != nullptr) {
+			std::lock_guard<std::mutex> hold((*owner).pinned_lock);
+			(*owner).pinned.erase((*owner).pinned.find(stamp));
 		}
 	}
 	
 	/**
-	 * \brief This removes any \c default_value from the map by erasing the entry.
+	 * \brief This is \c extended::map<A, B>::operator>> as of the time of the snapshot.
+	 * 
+	 * \param [in] input is the location of the desired value.
+	 * \return Returns the value the location had at that time, or the \c default_value if it had none.
+	 */
+	template <class A, class B>
+	B mvcc_map<A, B>::snapshot::operator>> (A input) const {
+		std::shared_lock<std::shared_mutex> hold((*owner).data_lock);
+		auto it = (*owner).data.find(input);
+		if (it != (*owner).data.end()) {
+			return (*owner).visible((*it).second, stamp);
+		}
+		return (*owner).default_value;
+	}
+	
+	/**
+	 * \brief This calls a function on every entry that was not the \c default_value at the time of the snapshot, in key order.
 	 * 
+	 * \param [in] f is called as \c f(key, value) with copies taken under the lock.
 	 * \return Returns \c void.
+	 * 
+	 * \details The map is read \c scan_step entries at a time, the lock is let go between steps and the scan finds its place again with \c upper_bound, so writers are never held up for the whole scan. \c f is called outside the lock.
 	 */
 	template <class A, class B>
-	void map<A, B>::operator! () {
-		uint64_t temp = 0;
-		for (auto it = (*this).cbegin(); it != (*this).cend(); ) {
-			if ((*it).second == default_value) {
-				temp = std::distance((*this).cbegin(), it);
-				(*this).erase(it);
-				it = (*this).cbegin();
-				std::advance(it, temp);
-			} else {
-				std::advance(it, 1);
+	template <class F>
+	void mvcc_map<A, B>::snapshot::for_each(F f) const {
+		std::vector<std::pair<A, B>> step;
+		std::optional<A>             last;
+		while (true) {
+			step.clear();
+			{
+				std::shared_lock<std::shared_mutex> hold((*owner).data_lock);
+				auto it = last ? (*owner).data.upper_bound(*last) : (*owner).data.begin();
+				for (std::size_t seen = 0; (it != (*owner).data.end()) && (seen < scan_step); std::advance(it, 1), seen++) {
+					const B& value = (*owner).visible((*it).second, stamp);
+					if (value != (*owner).default_value) {
+						step.emplace_back((*it).first, value);
+					}
+					last = (*it).first;
+				}
+				if (it == (*owner).data.end()) {
+					hold.unlock();
+					for (auto& entry : step) {
+						f(entry.first, entry.second);
+					}
+					return;
+				}
+			}
+			for (auto& entry : step) {
+				f(entry.first, entry.second);
 			}
 		}
 	}
 	
+	/**
+	 * \brief This gives the time the snapshot reads at.
+	 * 
+	 * \return Returns the time, every write with a later time is not seen.
+	 */
+	template <class A, class B>
+	uint64_t mvcc_map<A, B>::snapshot::time() const {
+		return stamp;
+	}
 	
 	/**
 	 *  \brief Default constructor
 	 *  
-	 *  \details This default constructor does nothing except call the \c std::map<A, std::string> default constructor
+	 *  \details This default constructor uses the \ref null "extended::null<B>" \c default_value.
 	 */
-	template <class A>
-	map<A, std::string>::map() : std::map<A, std::string>() {}
+	template <class A, class B>
+	mvcc_map<A, B>::mvcc_map() : mvcc_map(null<B>::value) {}
 	
 	/**
 	 *  \brief Constructor.
 	 * 
-	 *  \param [in] default_val is the \c default_value for this \c extended::map<A, std::string>.
-	 * 
-	 *  \details This constructor calls the \c std::map<A, std::string> default constructor and sets \c default_value to \c default_val.
+	 *  \param [in] default_val is the \c default_value for this \c extended::mvcc_map<A, B>.
 	 */
-	template <class A>
-	map<A, std::string>::map(std::string default_val) : std::map<A, std::string>() {
+	template <class A, class B>
+	mvcc_map<A, B>::mvcc_map(B default_val) {
 		default_value = default_val;
 	}
 	
 	/**
-	 * \brief Constructor.
+	 * \brief This finds the value of a key at a time, the caller holds \c data_lock.
 	 * 
-	 * \param [in] default_val is the \c default_value for this \c extended::map<A, std::string>.
-	 * \param [in] args are the arguments to be sent to the \c std::map<A, std::string> default constructor
+	 * \param [in] chain is the version chain of the key.
+	 * \param [in] time is the time to read at.
+	 * \return Returns the newest value not newer than \c time, or the \c default_value if there is none.
+	 */
+	template <class A, class B>
+	const B& mvcc_map<A, B>::visible(const std::vector<version>& chain, uint64_t time) const {
+		for (auto it = chain.rbegin(); it != chain.rend(); std::advance(it, 1)) {
+			if ((*it).stamp <= time) {
+				return (*it).value;
+			}
+		}
+		return default_value;
+	}
+	
+	/**
+	 * \brief This finds the oldest time any snapshot reads at, the caller holds \c data_lock alone.
 	 * 
+	 * \return Returns the oldest pinned time, or the current time if there is no snapshot.
+	 */
+	template <class A, class B>
+	uint64_t mvcc_map<A, B>::oldest() const {
+		std::lock_guard<std::mutex> hold(pinned_lock);
+		return pinned.empty() ? clock.load(std::memory_order_relaxed) : *pinned.begin();
+	}
+	
+	/**
+	 * \brief This is the thread safe version of \c extended::map<A, B>::operator>> on the newest values.
 	 * 
-	 * \details This constructor calls the \c std::map<A, std::string> constructor, while passing \c args to it and sets \c default_value to \c default_val.
+	 * \param [in] input is the location of the desired value.
+	 * \return Returns the value of the location if it exists, however, if it does not exist, it will return the \c default_value.
 	 */
-	template <class A>
-	template<class... Args>
-	map<A, std::string>::map(std::string default_val, Args... args) : std::map<A, std::string>(args...){
-		default_value = default_val;
+	template <class A, class B>
+	B mvcc_map<A, B>::operator>> (A input) const {
+		std::shared_lock<std::shared_mutex> hold(data_lock);
+		auto it = data.find(input);
+		if (it != data.end()) {
+			return (*it).second.back().value;
+		}
+		return default_value;
 	}
 	
 	/**
-	 * \brief This adds a pair to the map if and only if the first value is already in use or the second value is not the default_value.
+	 * \brief This adds a new version of a key.
 	 * 
 	 * \param [in] input is the pair of the location and the desired value.
+	 * \param [in] keep is \c true for \c operator(), which stores a \c default_value version and leaves the key for \c operator! to erase.
 	 * \return Returns \c void.
+	 * 
+	 * \details When no snapshot is pinned the older versions are replaced straight away, so keys only build up a chain while snapshots are live. Then \c operator<< with the \c default_value erases the key outright, since no one can see its older versions.
 	 */
-	template <class A>
-	std::string map<A, std::string>::operator>> (A input) {
-		if ((*this).count(input) > 0) {
-			return (*this).operator[](input);
+	template <class A, class B>
+	void mvcc_map<A, B>::write(const std::pair<A, B>& input, bool keep) {
+		std::unique_lock<std::shared_mutex> hold(data_lock);
+		auto it = data.lower_bound(input.first);
+		bool found = (it != data.end()) && !data.key_comp()(input.first, (*it).first);
+		bool empty = (input.second == default_value);
+		if (!found && empty) {
+			return;
 		}
-		return default_value;
+		uint64_t stamp = clock.load(std::memory_order_relaxed) + 1;
+		bool alone;
+		{
+			std::lock_guard<std::mutex> held(pinned_lock);
+			alone = pinned.empty();
+		}
+		if (alone && empty && !keep) {
+			data.erase(it);
+			clock.store(stamp, std::memory_order_release);
+			return;
+		}
+		if (!found) {
+			it = data.emplace_hint(it, std::piecewise_construct, std::forward_as_tuple(input.first), std::forward_as_tuple());
+		}
+		if (alone) {
+			(*it).second.clear();
+		}
+		(*it).second.push_back(version{stamp, input.second});
+		clock.store(stamp, std::memory_order_release);
 	}
 	
 	/**
-	 * \brief This adds a pair to the map if and only if the first value is already in use or the second value is not the \c default_value.
+	 * \brief This adds a new version of a key, a \c default_value is stored as a version without erasing the key, which is left to \c operator! .
 	 * 
 	 * \param [in] input is the pair of the location and the desired value.
 	 * \return Returns \c void.
 	 */
-	template <class A>
-	void map<A, std::string>::operator() (std::pair<A, std::string> input) {
-		if (((*this).count(input.first) > 0) || (input.second != default_value)) {
-			(*this).operator[](input.first) = input.second;
-		}
+	template <class A, class B>
+	void mvcc_map<A, B>::operator() (std::pair<A, B> input) {
+		(*this).write(input, true);
 	}
 	
 	/**
-	 * \brief This adds a pair to the map if and only if the second value is not the \c default_value, if it is \c default_value, then it will also erase the entry.
+	 * \brief This adds a new version of a key, a \c default_value erases the key, or marks it erased for snapshots taken after it while older snapshots are live.
 	 * 
 	 * \param [in] input is the pair of the location and the desired value.
 	 * \return Returns \c void.
 	 */
-	template <class A>
-	void map<A, std::string>::operator<< (std::pair<A, std::string> input) {
-		if (input.second.compare(default_value) != 0) {
-			(*this).std::map<A, std::string>::operator[](input.first) = input.second;
-		} else if ((*this).std::map<A, std::string>::count(input.first) > 0) {
-			auto it = (*this).std::map<A, std::string>::begin();
-			it = (*this).find(input.first);
-			(*this).std::map<A, std::string>::erase(it);
-		}
+	template <class A, class B>
+	void mvcc_map<A, B>::operator<< (std::pair<A, B> input) {
+		(*this).write(input, false);
 	}
 	
 	/**
-	 * \brief This removes any \c default_value from the map by erasing the entry.
+	 * \brief This drops every version no snapshot can see and erases keys whose only version left is the \c default_value.
 	 * 
 	 * \return Returns \c void.
+	 * 
+	 * \details For each key the newest version not newer than the oldest snapshot is kept along with every version after it, since those are what the live snapshots and new readers can still see.
 	 */
-	template <class A>
-	void map<A, std::string>::operator! () {
-		uint64_t temp = 0;
-		for (auto it = (*this).cbegin(); it != (*this).cend(); ) {
-			if ((*it).second.compare(default_value) == 0) {
-				temp = std::distance((*this).cbegin(), it);
-				(*this).erase(it);
-				it = (*this).cbegin();
-				std::advance(it, temp);
+	template <class A, class B>
+	void mvcc_map<A, B>::operator! () {
+		std::unique_lock<std::shared_mutex> hold(data_lock);
+		uint64_t floor = (*this).oldest();
+		for (auto it = data.begin(); it != data.end(); ) {
+			std::vector<version>& chain = (*it).second;
+			std::size_t keep = 0;
+			for (std::size_t i = 0; i < chain.size(); i++) {
+				if (chain[i].stamp <= floor) {
+					keep = i;
+				}
+			}
+			chain.erase(chain.begin(), chain.begin() + keep);
+			if ((chain.size() == 1) && (chain[0].stamp <= floor) && (chain[0].value == default_value)) {
+				it = data.erase(it);
 			} else {
 				std::advance(it, 1);
 			}
 		}
 	}
+	
+	/**
+	 * \brief This pins the current time so that reads through the snapshot see the map as it is now.
+	 * 
+	 * \return Returns the snapshot.
+	 */
+	template <class A, class B>
+	typename mvcc_map<A, B>::snapshot mvcc_map<A, B>::pin() const {
+		std::shared_lock<std::shared_mutex> hold(data_lock);
+		std::lock_guard<std::mutex>         held(pinned_lock);
+		uint64_t stamp = clock.load(std::memory_order_acquire);
+		pinned.insert(stamp);
+		return snapshot(this, stamp);
+	}
+	
+	/**
+	 * \brief This counts the keys that have a version chain, including keys erased since the last \c operator! .
+	 * 
+	 * \return Returns the number of keys.
+	 */
+	template <class A, class B>
+	std::size_t mvcc_map<A, B>::size() const {
+		std::shared_lock<std::shared_mutex> hold(data_lock);
+		return data.size();
+	}
 	///@}
 }
 #endif
\ No newline at end of file
@@ -0,0 +1,444 @@
+/**
+ * \file pool.h
+ * \brief Home of \c extended::pool, the work stealing thread pool used by the parallel \c extended::map operations.
+ * \details --- Github repository link: <a href="https://github.com/yellowcamper/extended-maps">https://github.com/yellowcamper/extended-maps</a>
+ * \copyright Kenneth Michael (Mikey) Neal (c) 5 September 2021 under GNU GENERAL PUBLIC LICENSE Version 3, 29 June 2007
+ * \remark This code is still prerelease, do please report any bugs or errors through the github issue tracker.
+ */
+#ifndef __EXTENDED_POOL_H__
+#define __EXTENDED_POOL_H__
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace extended {
+	/**
+	 * \defgroup pool extended::pool
+	 *
+	 * \brief The work stealing thread pool.
+	 *
+	 * \details Every worker has its own Chase-Lev deque. A worker pushes and pops tasks at the bottom of its own deque without any lock, and an idle worker steals from the top of another worker's deque. Work given to the pool by a thread outside of it goes through a shared queue.
+	 * @{
+	 */
+
+	/**
+	 * \brief The work stealing thread pool used by the parallel \c extended::map operations.
+	 *
+	 * \details \c run splits a range of indexes in half again and again, keeping one half and pushing the other for idle workers to steal, so ranges that take longer are shared out without any planning. The thread that calls \c run works on the range too until it is done, so \c run may be called from inside a task.
+	 * \note \c shared is the pool every map operation uses, call \c configure before its first use to choose the number of threads and the CPUs they run on.
+	 */
+	class pool {
+		protected:
+			/**
+			 * \brief One piece of work, it frees itself after it runs.
+			 */
+			struct task {
+				std::function<void()> work; ///< \c work is what the task does.
+			};
+
+			/**
+			 * \brief The Chase-Lev deque of one worker, each is kept on its own cache line.
+			 *
+			 * \details Only the owner pushes and takes at the bottom, any thread may steal from the top. The deque does not grow, a task that does not fit is run right away by its owner instead.
+			 */
+			struct alignas(64) deque {
+				static const int64_t capacity = 4096; ///< \c capacity is the most tasks the deque holds.
+
+				std::atomic<int64_t> top{0};                  ///< \c top is the next task to steal.
+				std::atomic<int64_t> bottom{0};               ///< \c bottom is where the next task is pushed.
+				std::atomic<task*>   items[capacity] = {};    ///< \c items is the ring of tasks.
+
+				bool  push(task*);
+				task* take();
+				task* steal();
+			};
+
+			/**
+			 * \brief The settings of \c shared, they are read when it is first used.
+			 */
+			struct settings {
+				std::size_t      threads = 0; ///< \c threads is the number of workers, \c 0 uses one per hardware thread.
+				std::vector<int> cpus;        ///< \c cpus is the CPUs the workers are pinned to in turn, empty leaves them unpinned.
+				bool             used = false; ///< \c used is \c true once \c shared has been made.
+			};
+
+			std::vector<std::unique_ptr<deque>> deques;            ///< \c deques is the deque of each worker.
+			std::vector<std::thread>            workers;           ///< \c workers is the worker threads.
+			std::deque<task*>                   inbox;             ///< \c inbox is the work given by threads outside the pool.
+			std::mutex                          lock;              ///< \c lock guards \c inbox and sleeping.
+			std::condition_variable             wake;              ///< \c wake wakes sleeping workers.
+			std::atomic<std::size_t>            sleeping{0};       ///< \c sleeping is the number of workers waiting on \c wake.
+			std::atomic<std::size_t>            queued{0};         ///< \c queued is the number of tasks in \c inbox and the deques, a worker only sleeps while it is \c 0.
+			std::atomic<bool>                   stopping{false};   ///< \c stopping is \c true once the pool is being destroyed.
+
+			static settings&  config();
+			static std::size_t& self_index();
+			static pool*&     self_pool();
+
+			void  submit(task*);
+			task* find(std::size_t);
+			bool  help();
+			void  work(std::size_t, int);
+		public:
+			pool(std::size_t = 0, std::vector<int> = {});
+			pool(const pool&) = delete;
+			pool& operator= (const pool&) = delete;
+			~pool();
+
+			static pool& shared();
+			static bool  configure(std::size_t, std::vector<int> = {});
+
+			std::size_t size() const;
+			template<class F> void run(std::size_t, F);
+	};
+
+	/**
+	 * \brief This pushes a task at the bottom of the deque, only its owner may call this.
+	 *
+	 * \param [in] item is the task.
+	 * \return Returns \c false if the deque is full.
+	 */
+	inline bool pool::deque::push(task* item) {
+		int64_t b = bottom.load(std::memory_order_relaxed);
+		int64_t t = top.load(std::memory_order_acquire);
+		if (b - t >= capacity) {
+			return false;
+		}
+		items[b % capacity].store(item, std::memory_order_release);
+		std::atomic_thread_fence(std::memory_order_release);
+		bottom.store(b + 1, std::memory_order_relaxed);
+		return true;
+	}
+
+	/**
+	 * \brief This takes the task at the bottom of the deque, only its owner may call this.
+	 *
+	 * \return Returns the task, or \c nullptr if the deque is empty or a thief got the last task first.
+	 */
+	inline pool::task* pool::deque::take() {
+		int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+		bottom.store(b, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t t = top.load(std::memory_order_relaxed);
+		if (t > b) {
+			bottom.store(b + 1, std::memory_order_relaxed);
+			return nullptr;
+		}
+		task* item = items[b % capacity].load(std::memory_order_relaxed);
+		if (t == b) {
+			if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+				item = nullptr;
+			}
+			bottom.store(b + 1, std::memory_order_relaxed);
+		}
+		return item;
+	}
+
+	/**
+	 * \brief This steals the task at the top of the deque, any thread may call this.
+	 *
+	 * \return Returns the task, or \c nullptr if the deque is empty or another thread got it first.
+	 */
+	inline pool::task* pool::deque::steal() {
+		int64_t t = top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t b = bottom.load(std::memory_order_acquire);
+		if (t >= b) {
+			return nullptr;
+		}
+		task* item = items[t % capacity].load(std::memory_order_acquire);
+		if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+			return nullptr;
+		}
+		return item;
+	}
+
+	/**
+	 *  \brief Constructor.
+	 *
+	 *  \param [in] threads is the number of workers, \c 0 uses one per hardware thread less the calling thread, and there is always at least one.
+	 *  \param [in] cpus is the CPUs the workers are pinned to in turn, empty leaves them unpinned. Pinning is only done on Linux.
+	 */
+	inline pool::pool(std::size_t threads, std::vector<int> cpus) {
+		if (threads == 0) {
+			threads = std::max<std::size_t>(std::thread::hardware_concurrency(), 2) - 1;
+		}
+		for (std::size_t i = 0; i < threads; i++) {
+			deques.emplace_back(new deque());
+		}
+		for (std::size_t i = 0; i < threads; i++) {
+			workers.emplace_back(&pool::work, this, i, cpus.empty() ? -1 : cpus[i % cpus.size()]);
+		}
+	}
+
+	/**
+	 *  \brief Destructor.
+	 *
+	 *  \details This stops every worker once it finishes its current task, no \c run may still be going. Tasks that were never run are freed.
+	 */
+	inline pool::~pool() {
+		{
+			std::lock_guard<std::mutex> hold(lock);
+			stopping.store(true);
+		}
+		wake.notify_all();
+		for (auto& worker : workers) {
+			worker.join();
+		}
+		for (task* item : inbox) {
+			delete item;
+		}
+		for (auto& queue : deques) {
+			for (task* item = (*queue).steal(); item != nullptr; item = (*queue).steal()) {
+				delete item;
+			}
+		}
+	}
+
+	/**
+	 * \brief This holds the settings of \c shared.
+	 *
+	 * \return Returns the settings.
+	 */
+	inline pool::settings& pool::config() {
+		static settings values;
+		return values;
+	}
+
+	/**
+	 * \brief This holds which worker the current thread is.
+	 *
+	 * \return Returns the index of the worker, it is only used when \c self_pool is set.
+	 */
+	inline std::size_t& pool::self_index() {
+		static thread_local std::size_t index = 0;
+		return index;
+	}
+
+	/**
+	 * \brief This holds which pool the current thread works for.
+	 *
+	 * \return Returns the pool, or \c nullptr for a thread outside of every pool.
+	 */
+	inline pool*& pool::self_pool() {
+		static thread_local pool* owner = nullptr;
+		return owner;
+	}
+
+	/**
+	 * \brief This gets the pool every parallel map operation uses, making it the first time.
+	 *
+	 * \return Returns the pool.
+	 */
+	inline pool& pool::shared() {
+		static pool instance([]() {
+			config().used = true;
+			return config().threads;
+		}(), config().cpus);
+		return instance;
+	}
+
+	/**
+	 * \brief This sets up \c shared, it only works before \c shared is first used.
+	 *
+	 * \param [in] threads is the number of workers, \c 0 uses one per hardware thread less the calling thread.
+	 * \param [in] cpus is the CPUs the workers are pinned to in turn, empty leaves them unpinned.
+	 * \return Returns \c false if \c shared was already made.
+	 */
+	inline bool pool::configure(std::size_t threads, std::vector<int> cpus) {
+		if (config().used) {
+			return false;
+		}
+		config().threads = threads;
+		config().cpus    = cpus;
+		return true;
+	}
+
+	/**
+	 * \brief This gets the number of workers.
+	 *
+	 * \return Returns the number of workers, the thread calling \c run also works so one more thread is busy.
+	 */
+	inline std::size_t pool::size() const {
+		return workers.size();
+	}
+
+	/**
+	 * \brief This gives a task to the pool, on the deque of the current worker or through \c inbox.
+	 *
+	 * \param [in] item is the task, it is freed if this throws.
+	 * \return Returns \c void.
+	 *
+	 * \details \c queued is raised before \c sleeping is read and a worker raises \c sleeping before it reads \c queued, so one of the two always sees the other. \c lock is taken before the notify, so a worker that saw \c queued at \c 0 is already waiting and cannot miss it.
+	 */
+	inline void pool::submit(task* item) {
+		std::unique_ptr<task> owned(item);
+		if ((self_pool() != this) || !(*deques[self_index()]).push(item)) {
+			if (self_pool() == this) {
+				(*item).work();
+				return;
+			}
+			std::lock_guard<std::mutex> hold(lock);
+			inbox.push_back(item);
+		}
+		owned.release();
+		queued.fetch_add(1, std::memory_order_seq_cst);
+		if (sleeping.load(std::memory_order_seq_cst) > 0) {
+			{
+				std::lock_guard<std::mutex> hold(lock);
+			}
+			wake.notify_one();
+		}
+	}
+
+	/**
+	 * \brief This finds a task to run.
+	 *
+	 * \param [in] start is where to start looking for a deque to steal from.
+	 * \return Returns the task, or \c nullptr if there is none.
+	 *
+	 * \details A worker looks in its own deque first, then steals from the others in turn, then looks in \c inbox.
+	 */
+	inline pool::task* pool::find(std::size_t start) {
+		if (self_pool() == this) {
+			task* item = (*deques[self_index()]).take();
+			if (item != nullptr) {
+				return item;
+			}
+		}
+		for (std::size_t i = 0; i < deques.size(); i++) {
+			task* item = (*deques[(start + i) % deques.size()]).steal();
+			if (item != nullptr) {
+				return item;
+			}
+		}
+		std::lock_guard<std::mutex> hold(lock);
+		if (!inbox.empty()) {
+			task* item = inbox.front();
+			inbox.pop_front();
+			return item;
+		}
+		return nullptr;
+	}
+
+	/**
+	 * \brief This runs one task if one can be found, it is how a waiting thread helps.
+	 *
+	 * \return Returns \c true if a task was run.
+	 */
+	inline bool pool::help() {
+		static thread_local std::size_t start = 0;
+		std::unique_ptr<task> item((*this).find(start++));
+		if (item == nullptr) {
+			return false;
+		}
+		queued.fetch_sub(1, std::memory_order_seq_cst);
+		(*item).work();
+		return true;
+	}
+
+	/**
+	 * \brief This is the loop each worker runs until the pool is destroyed.
+	 *
+	 * \param [in] index is the index of the worker.
+	 * \param [in] cpu is the CPU to pin the worker to, or -1.
+	 * \return Returns \c void.
+	 *
+	 * \details A worker that finds nothing to run sleeps on \c wake until a task is queued or the pool stops, it does not wake up on its own.
+	 */
+	inline void pool::work(std::size_t index, int cpu) {
+#if defined(__linux__)
+		if (cpu >= 0) {
+			cpu_set_t set;
+			CPU_ZERO(&set);
+			CPU_SET(cpu, &set);
+			pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+		}
+#else
+		(void)cpu;
+#endif
+		self_pool()  = this;
+		self_index() = index;
+		while (!stopping.load(std::memory_order_acquire)) {
+			bool ran = false;
+			for (int spins = 0; (spins < 64) && !ran; spins++) {
+				ran = (*this).help();
+			}
+			if (ran) {
+				continue;
+			}
+			std::unique_lock<std::mutex> hold(lock);
+			sleeping.fetch_add(1, std::memory_order_seq_cst);
+			wake.wait(hold, [this]() { return (queued.load(std::memory_order_seq_cst) > 0) || stopping.load(std::memory_order_acquire); });
+			sleeping.fetch_sub(1, std::memory_order_seq_cst);
+		}
+	}
+
+	/**
+	 * \brief This runs a function for every index of a range, splitting the range across the workers.
+	 *
+	 * \param [in] count is the number of indexes.
+	 * \param [in] f is called as \c f(i) once for each \c i from \c 0 up to \c count, it must be safe to call from several threads at once.
+	 * \return Returns \c void.
+	 *
+	 * \details The range is halved again and again, one half is pushed for other workers to steal and the other is kept, until single indexes are left to run. The calling thread runs its share and then helps with other tasks until the whole range is done.
+	 * \details If \c f throws, the indexes that have not started are skipped, and once every task of the range has finished the first exception is thrown again from \c run on the calling thread. A half that cannot be pushed is run by the thread that split it.
+	 */
+	template <class F>
+	void pool::run(std::size_t count, F f) {
+		if (count == 0) {
+			return;
+		}
+		std::atomic<std::size_t> left{count};
+		std::atomic<bool>        failed{false};
+		std::exception_ptr       error;
+		std::function<void(std::size_t, std::size_t)> split;
+		split = [&](std::size_t begin, std::size_t end) {
+			while (end - begin > 1) {
+				std::size_t middle = begin + (end - begin) / 2;
+				try {
+					(*this).submit(new task{[&split, middle, end]() { split(middle, end); }});
+				} catch (...) {
+					break;
+				}
+				end = middle;
+			}
+			for (std::size_t i = begin; i < end; i++) {
+				if (!failed.load(std::memory_order_relaxed)) {
+					try {
+						f(i);
+					} catch (...) {
+						if (!failed.exchange(true, std::memory_order_relaxed)) {
+							error = std::current_exception();
+						}
+					}
+				}
+				left.fetch_sub(1, std::memory_order_acq_rel);
+			}
+		};
+		split(0, count);
+		while (left.load(std::memory_order_acquire) > 0) {
+			if (!(*this).help()) {
+				std::this_thread::yield();
+			}
+		}
+		if (error) {
+			std::rethrow_exception(error);
+		}
+	}
+	///@}
+}
+#endif
@@ -0,0 +1,45 @@
+#include "extended.h"
+#include "check.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+// A batch leaves the map exactly as giving each pair to operator<< in order would, repeats and erasures included.
+static void same_as_writing_one_by_one() {
+	std::mt19937            random(11);
+	extended::map<int, int> batched;
+	extended::map<int, int> single;
+	for (int round = 0; round < 20; ++round) {
+		std::vector<std::pair<int, int>> batch;
+		for (int i = 0; i < 500; ++i) {
+			batch.emplace_back((int)(random() % 300), (int)(random() % 4)); // a quarter are erasures
+		}
+		batched.apply_batch(batch.begin(), batch.end());
+		for (auto& item : batch) {
+			single << item;
+		}
+		CHECK(batched.size() == single.size());
+		CHECK(std::equal(batched.begin(), batched.end(), single.begin()));
+	}
+}
+
+// The key filter learns the keys a batch adds, so they are still found with it on.
+static void batch_with_the_filter_on() {
+	extended::map<int, int> m;
+	m.use_filter();
+	std::vector<std::pair<int, int>> batch;
+	for (int i = 0; i < 5000; ++i) {
+		batch.emplace_back(i * 3, i + 1);
+	}
+	m.apply_batch(batch.begin(), batch.end());
+	for (int i = 0; i < 5000; ++i) {
+		CHECK((m >> (i * 3)) == i + 1);
+	}
+}
+
+int main() {
+	same_as_writing_one_by_one();
+	batch_with_the_filter_on();
+	return 0;
+}
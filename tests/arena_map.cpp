@@ -0,0 +1,146 @@
+#include "extended.h"
+#include "check.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <string>
+#include <utility>
+
+// Counts the calls to the global operator delete, to see how much work a teardown does.
+static std::atomic<std::size_t> deletes{0};
+
+void* operator new(std::size_t bytes) {
+	if (void* out = std::malloc(bytes ? bytes : 1)) {
+		return out;
+	}
+	throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept {
+	deletes++;
+	std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+	deletes++;
+	std::free(memory);
+}
+
+/**
+ * \brief A value that counts its destructors, so the test can see which nodes are visited.
+ */
+struct counted {
+	static inline std::size_t alive = 0;
+	int value = 0;
+
+	counted() { ++alive; }
+	counted(int v) : value(v) { ++alive; }
+	counted(const counted& other) : value(other.value) { ++alive; }
+	~counted() { --alive; }
+	counted& operator= (const counted&) = default;
+	bool operator== (const counted& other) const { return value == other.value; }
+	bool operator!= (const counted& other) const { return value != other.value; }
+};
+
+// The operators behave exactly as they do on extended::map.
+static void same_as_map() {
+	std::mt19937                 random(46);
+	extended::arena_map<int, int> arena;
+	extended::map<int, int>       plain;
+	for (int i = 0; i < 20000; ++i) {
+		std::pair<int, int> item((int)(random() % 2000), (int)(random() % 4));
+		if (i % 3 == 0) {
+			arena(item);
+			plain(item);
+		} else {
+			arena << item;
+			plain << item;
+		}
+		if (i % 5000 == 0) {
+			!arena;
+			!plain;
+		}
+	}
+	CHECK(arena->size() == plain.size());
+	CHECK(std::equal(arena->begin(), arena->end(), plain.begin()));
+	for (int key = 0; key < 2000; ++key) {
+		CHECK((arena >> key) == (plain >> key));
+	}
+}
+
+// Destroying a map of trivial types frees a handful of blocks, however many entries it has.
+static void teardown_does_not_visit_nodes() {
+	auto* m = new extended::arena_map<int, int>();
+	for (int key = 0; key < 100000; ++key) {
+		(*m) << std::make_pair(key, key + 1);
+	}
+	std::size_t start = deletes.load();
+	delete m;
+	std::size_t freed = deletes.load() - start;
+	CHECK(freed < 32); // the blocks, the arena and the map, never one per node
+}
+
+// Values with destructors still have them run, only the freeing is skipped.
+static void non_trivial_values_are_destroyed() {
+	{
+		extended::arena_map<int, counted> m;
+		for (int key = 0; key < 1000; ++key) {
+			m << std::make_pair(key, counted(key + 1));
+		}
+		CHECK(counted::alive >= 1000);
+		std::size_t start = deletes.load();
+		m.clear();
+		CHECK(deletes.load() - start < 32);
+		CHECK(m->empty());
+		m << std::make_pair(1, counted(2));
+		CHECK((m >> 1).value == 2);
+	}
+	CHECK(counted::alive == 1); // only the default value of the static null is left
+}
+
+// clear keeps the newest block, so once it is large enough building the same map again does not grow the arena.
+static void clear_reuses_the_arena() {
+	extended::arena_map<int, std::string> m;
+	std::size_t                           grown = 0;
+	for (int round = 0; round < 5; ++round) {
+		for (int key = 0; key < 5000; ++key) {
+			m << std::make_pair(key, std::string("v"));
+		}
+		CHECK(m->size() == 5000);
+		if (round == 2) {
+			grown = m.footprint();
+		} else if (round > 2) {
+			CHECK(m.footprint() == grown);
+		}
+		m.clear();
+		CHECK(m->empty());
+		CHECK((m >> 0).empty());
+	}
+}
+
+// The arena keeps each allocation aligned as asked.
+static void arena_alignment() {
+	extended::arena region;
+	for (std::size_t align = 1; align <= 64; align *= 2) {
+		region.allocate(1, 1);
+		void* memory = region.allocate(24, align);
+		CHECK(((std::uintptr_t)memory % align) == 0);
+	}
+	void* large = region.allocate(1 << 20, 16); // larger than any block so far
+	CHECK(large != nullptr);
+	CHECK(region.footprint() > (1 << 20));
+	region.release();
+	CHECK(region.footprint() > (1 << 20)); // the newest block is kept
+}
+
+int main() {
+	same_as_map();
+	teardown_does_not_visit_nodes();
+	non_trivial_values_are_destroyed();
+	clear_reuses_the_arena();
+	arena_alignment();
+	return 0;
+}
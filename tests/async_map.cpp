@@ -0,0 +1,97 @@
+#include "extended.h"
+#include "check.h"
+
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * \brief A value whose assignment throws for one poisoned value, so the applier thread fails on it while queueing still works.
+ */
+struct touchy {
+	int value = 0;
+	
+	touchy() = default;
+	touchy(int v) : value(v) {}
+	touchy(const touchy&) = default;
+	touchy(touchy&&) noexcept = default;
+	touchy& operator= (const touchy& other) {
+		if (other.value == 666) {
+			throw std::runtime_error("poisoned");
+		}
+		value = other.value;
+		return *this;
+	}
+	touchy& operator= (touchy&& other) {
+		return (*this) = static_cast<const touchy&>(other);
+	}
+	bool operator== (const touchy& other) const { return value == other.value; }
+	bool operator!= (const touchy& other) const { return value != other.value; }
+};
+
+static void futures_and_read_your_writes() {
+	extended::async_map<int, std::string> m;
+	auto first = m << std::make_pair(1, std::string("one"));
+	CHECK((m >> 1) == "one"); // the writing thread sees its own write
+	first.get();
+	m << std::make_pair(1, std::string());
+	m(std::make_pair(2, std::string()));
+	m.flush();
+	CHECK((m >> 1).empty());
+	CHECK((m >> 2).empty());
+}
+
+// A queue of four cells with eight writers keeps filling up, writers must be woken when the applier frees cells.
+static void writers_wait_for_room() {
+	extended::async_map<int, int> m(0, 4, extended::consistency::eventual);
+	std::vector<std::thread>      writers;
+	for (int t = 0; t < 8; ++t) {
+		writers.emplace_back([&m, t] {
+			for (int i = 0; i < 2000; ++i) {
+				m << std::make_pair(t * 10000 + i, i + 1);
+			}
+		});
+	}
+	for (auto& writer : writers) {
+		writer.join();
+	}
+	m.flush();
+	for (int t = 0; t < 8; ++t) {
+		CHECK((m >> (t * 10000 + 1999)) == 2000);
+	}
+}
+
+// A write that throws on the applier reaches only its own future, the writes around it still apply.
+static void errors_reach_the_writer() {
+	extended::async_map<int, touchy> m;
+	m << std::make_pair(1, touchy(1));
+	m.flush();
+	auto before = m << std::make_pair(2, touchy(2));
+	auto bad    = m << std::make_pair(1, touchy(666));
+	auto after  = m << std::make_pair(3, touchy(3));
+	before.get();
+	after.get();
+	bool caught = false;
+	try {
+		bad.get();
+	} catch (const std::runtime_error&) {
+		caught = true;
+	}
+	CHECK(caught);
+	CHECK((m >> 1).value == 1);
+	CHECK((m >> 2).value == 2);
+	CHECK((m >> 3).value == 3);
+	
+	std::promise<bool> called;
+	m.write(std::make_pair(4, touchy(4)), [&](std::exception_ptr error) { called.set_value(!error); });
+	CHECK(called.get_future().get());
+}
+
+int main() {
+	futures_and_read_your_writes();
+	writers_wait_for_room();
+	errors_reach_the_writer();
+	return 0;
+}
@@ -0,0 +1,46 @@
+#include "extended.h"
+#include "check.h"
+
+#include <string>
+#include <vector>
+
+// A sorted range is loaded as is, pairs with the default value are left out.
+static void sorted_range() {
+	std::vector<std::pair<int, int>> items;
+	for (int i = 0; i < 1000; ++i) {
+		items.emplace_back(i, i % 10);
+	}
+	extended::map<int, int> m(0, items.begin(), items.end(), extended::bulk{true});
+	CHECK(m.size() == 900);
+	CHECK((m >> 10) == 0);
+	CHECK(m.count(10) == 0);
+	CHECK((m >> 11) == 1);
+}
+
+// An unsorted range is sorted first, and the last pair of a repeated key wins, even when it is the default.
+static void unsorted_range_with_repeats() {
+	std::vector<std::pair<int, std::string>> items{
+		{5, "first"}, {1, "one"}, {5, "second"}, {3, "three"}, {3, ""}, {2, ""}, {5, "last"}
+	};
+	extended::map<int, std::string> m(std::string(), items.begin(), items.end(), extended::bulk{});
+	CHECK(m.size() == 2);
+	CHECK((m >> 1) == "one");
+	CHECK((m >> 5) == "last");
+	CHECK(m.count(3) == 0);
+	CHECK(m.count(2) == 0);
+}
+
+// Any input iterator works, not only those of a vector.
+static void from_another_map() {
+	std::map<int, int>      source{{1, 10}, {2, 0}, {3, 30}};
+	extended::map<int, int> m(0, source.begin(), source.end(), extended::bulk{true});
+	CHECK(m.size() == 2);
+	CHECK((m >> 3) == 30);
+}
+
+int main() {
+	sorted_range();
+	unsorted_range_with_repeats();
+	from_another_map();
+	return 0;
+}
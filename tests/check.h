@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+
+/**
+ * \brief Fails the test with the file and line when \c condition is false, in every build type.
+ */
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+			std::exit(EXIT_FAILURE); \
+		} \
+	} while (false)
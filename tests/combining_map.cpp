@@ -0,0 +1,70 @@
+#include "extended.h"
+#include "check.h"
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+/**
+ * \brief Opens up the buffer list so the test can see buffers of ended threads go.
+ */
+struct watched : extended::combining_map<int, long, extended::sum<long>> {
+	using combining_map::combining_map;
+	
+	std::size_t buffer_count() {
+		std::lock_guard<std::mutex> hold(buffers_lock);
+		return buffers.size();
+	}
+};
+
+// Increments from many threads add up exactly, and a key whose total comes back to the default is dropped.
+static void increments_add_up() {
+	extended::combining_map<int, long, extended::sum<long>> m;
+	std::vector<std::thread>                                 writers;
+	for (int t = 0; t < 4; ++t) {
+		writers.emplace_back([&m] {
+			for (int i = 0; i < 10000; ++i) {
+				m << std::make_pair(i % 100, 1L);
+				m << std::make_pair(-1, (i % 2) ? 1L : -1L); // nets to zero
+			}
+		});
+	}
+	for (auto& writer : writers) {
+		writer.join();
+	}
+	m.flush();
+	for (int key = 0; key < 100; ++key) {
+		CHECK((m >> key) == 400);
+	}
+	CHECK((m >> -1) == 0);
+}
+
+// A thread that writes and ends without a flush still has its updates merged once they are old, and its buffer is removed.
+static void ended_threads_are_merged() {
+	watched m;
+	m.limits(4096, std::chrono::milliseconds(200));
+	std::thread([&m] { m << std::make_pair(7, 5L); }).join();
+	CHECK((m >> 7) == 0); // not merged yet, the buffer is young
+	std::this_thread::sleep_for(std::chrono::milliseconds(300));
+	CHECK((m >> 7) == 5); // the read swept the aged buffer of the ended thread
+	CHECK(m.buffer_count() == 0);
+}
+
+// The default merge is overwrite, so the last update of a key wins.
+static void overwrite_by_default() {
+	extended::combining_map<int, int> m;
+	m << std::make_pair(1, 10);
+	m << std::make_pair(1, 20);
+	m << std::make_pair(2, 30);
+	m << std::make_pair(2, 0);
+	m.flush();
+	CHECK((m >> 1) == 20);
+	CHECK((m >> 2) == 0);
+}
+
+int main() {
+	increments_add_up();
+	ended_threads_are_merged();
+	overwrite_by_default();
+	return 0;
+}
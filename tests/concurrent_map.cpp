@@ -0,0 +1,87 @@
+#include "extended.h"
+#include "check.h"
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Writers on their own keys and readers on all keys run at once, readers only ever see a key's default or a value written for it.
+static void writers_and_readers_at_once() {
+	extended::concurrent_map<int, int> m(0, 8);
+	CHECK(m.shard_count() == 8);
+	std::atomic<bool>        done{false};
+	std::atomic<int>         wrong{0};
+	std::vector<std::thread> threads;
+	for (int t = 0; t < 4; ++t) {
+		threads.emplace_back([&m, t] {
+			for (int round = 1; round <= 20; ++round) {
+				for (int i = 0; i < 500; ++i) {
+					m << std::make_pair(t * 1000 + i, (round % 5 == 2) ? 0 : round * 1000 + i);
+				}
+			}
+		});
+	}
+	for (int t = 0; t < 2; ++t) {
+		threads.emplace_back([&] {
+			while (!done.load()) {
+				for (int key = 0; key < 4000; key += 7) {
+					int value = m >> key;
+					if ((value != 0) && (value % 1000 != key % 1000)) {
+						wrong++;
+					}
+				}
+			}
+		});
+	}
+	for (int t = 0; t < 4; ++t) {
+		threads[t].join();
+	}
+	done = true;
+	for (int t = 4; t < 6; ++t) {
+		threads[t].join();
+	}
+	CHECK(wrong.load() == 0);
+	CHECK(m.size() == 2000); // round 20 wrote every key, not as an erase
+	CHECK((m >> 3499) == 20499);
+}
+
+// operator() keeps entries at the default, operator! clears them shard by shard.
+static void compaction() {
+	extended::concurrent_map<std::string, int> m(-1);
+	m << std::make_pair(std::string("a"), 1);
+	m << std::make_pair(std::string("b"), 2);
+	m(std::make_pair(std::string("a"), -1));
+	m(std::make_pair(std::string("c"), -1));
+	CHECK(m.size() == 2);
+	!m;
+	CHECK(m.size() == 1);
+	CHECK((m >> "a") == -1);
+	CHECK((m >> "b") == 2);
+}
+
+/**
+ * \brief A key without \c std::hash, all such keys share one shard.
+ */
+struct point {
+	int x;
+	int y;
+	bool operator< (const point& other) const { return (x < other.x) || ((x == other.x) && (y < other.y)); }
+};
+
+static void keys_without_hash() {
+	extended::concurrent_map<point, int> m;
+	m << std::make_pair(point{1, 2}, 3);
+	m << std::make_pair(point{2, 1}, 4);
+	CHECK((m >> point{1, 2}) == 3);
+	CHECK((m >> point{2, 1}) == 4);
+	CHECK((m >> point{0, 0}) == 0);
+	CHECK(m.size() == 2);
+}
+
+int main() {
+	writers_and_readers_at_once();
+	compaction();
+	keys_without_hash();
+	return 0;
+}
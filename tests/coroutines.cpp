@@ -0,0 +1,225 @@
+#include "extended.h"
+#include "check.h"
+
+#include <coroutine>
+#include <deque>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * \brief A single threaded event loop, it counts how often an operation handed itself back.
+ */
+struct event_loop {
+	std::deque<std::coroutine_handle<>> queue;      ///< \c queue is the suspended operations waiting to be resumed.
+	std::size_t                         posted = 0; ///< \c posted is how many times an operation suspended.
+
+	extended::pacing every(std::size_t items) {
+		return extended::pacing{items, [this](std::coroutine_handle<> operation) { queue.push_back(operation); ++posted; }};
+	}
+	void run(const extended::task& until) {
+		while (!until.done()) {
+			CHECK(!queue.empty()); // an unfinished operation is always waiting on the loop
+			std::coroutine_handle<> next = queue.front();
+			queue.pop_front();
+			next.resume();
+		}
+	}
+};
+
+static std::vector<std::pair<int, int>> read_all(extended::map<int, int>& m, extended::pacing how, event_loop& loop) {
+	std::vector<std::pair<int, int>> seen;
+	auto reader = [](extended::map<int, int>& m, extended::pacing how, std::vector<std::pair<int, int>>& seen) -> extended::task {
+		auto entries = m.entries_async(how);
+		while (std::optional<std::pair<int, int>> item = co_await entries.next()) {
+			seen.push_back(*item);
+		}
+	};
+	extended::task reading = reader(m, std::move(how), seen);
+	reading.start();
+	loop.run(reading);
+	reading.await_resume();
+	return seen;
+}
+
+// Without a post the operations run straight to the end the first time they are started.
+static void no_post_runs_to_the_end() {
+	extended::map<int, int> m;
+	extended::task applying = m.apply_async({{3, 30}, {1, 10}, {2, 0}, {1, 11}});
+	CHECK(!applying.done());
+	applying.start();
+	CHECK(applying.done());
+	CHECK(m.size() == 2);
+	CHECK((m >> 1) == 11);
+	CHECK((m >> 3) == 30);
+}
+
+// A batch suspends once between every items pairs and ends as if each pair was given to operator<< in order.
+static void apply_suspends_every_items() {
+	event_loop              loop;
+	extended::map<int, int> m;
+	extended::map<int, int> single;
+	std::vector<std::pair<int, int>> batch;
+	for (int i = 0; i < 1000; ++i) {
+		batch.emplace_back((i * 7) % 300, i % 5); // repeats across parts, and every fifth is an erasure
+	}
+	for (auto& item : batch) {
+		single << item;
+	}
+	extended::task applying = m.apply_async(batch, loop.every(64));
+	applying.start();
+	CHECK(loop.posted == 1);
+	loop.run(applying);
+	applying.await_resume();
+	CHECK(loop.posted == (1000 + 63) / 64 - 1);
+	CHECK(m.size() == single.size());
+	CHECK(std::equal(m.begin(), m.end(), single.begin()));
+}
+
+// Compaction suspends after exactly every items entries it checks and leaves only the saved values.
+static void compact_suspends_every_items() {
+	event_loop              loop;
+	extended::map<int, int> m;
+	for (int i = 0; i < 1000; ++i) {
+		m << std::make_pair(i, 1);
+		m(std::make_pair(i, i % 4)); // operator() leaves an existing entry in place at the default
+	}
+	CHECK(m.size() == 1000);
+	extended::task compacting = m.compact_async(loop.every(100));
+	compacting.start();
+	loop.run(compacting);
+	compacting.await_resume();
+	CHECK(loop.posted == 9); // 1000 entries, no suspension after the last part
+	CHECK(m.size() == 750);
+	for (auto& entry : m) {
+		CHECK(entry.second != 0);
+	}
+}
+
+// The map may change while compaction is suspended, it carries on from the key it stopped at.
+static void compact_survives_changes_while_suspended() {
+	event_loop              loop;
+	extended::map<int, int> m;
+	for (int i = 0; i < 400; ++i) {
+		m << std::make_pair(i, 1);
+		m << std::make_pair(i + 1000, 1);
+		m(std::make_pair(i + 1000, 0));
+	}
+	extended::task compacting = m.compact_async(loop.every(50));
+	compacting.start();
+	while (!compacting.done()) {
+		m.erase(m.begin()); // the entry the operation checked first is gone
+		m << std::make_pair(2000 + (int)loop.posted, 1);
+		m(std::make_pair(2000 + (int)loop.posted, 0)); // and new unsaved entries appear ahead of it
+		std::coroutine_handle<> next = loop.queue.front();
+		loop.queue.pop_front();
+		next.resume();
+	}
+	compacting.await_resume();
+	for (auto& entry : m) {
+		CHECK(entry.second != 0);
+	}
+}
+
+// The entries are read in key order, skipping default values, with a suspension every items entries given.
+static void entries_in_order_with_pacing() {
+	event_loop              loop;
+	extended::map<int, int> m;
+	for (int i = 0; i < 500; ++i) {
+		m << std::make_pair(i, i % 3);
+	}
+	m << std::make_pair(10000, 1);
+	m(std::make_pair(10000, 0));
+	std::vector<std::pair<int, int>> seen = read_all(m, loop.every(32), loop);
+	std::vector<std::pair<int, int>> expected;
+	for (auto& entry : m) {
+		if (entry.second != 0) {
+			expected.push_back(entry);
+		}
+	}
+	CHECK(seen == expected);
+	CHECK(loop.posted == (expected.size() - 1) / 32);
+}
+
+// Awaiting one operation from another resumes the outer one when the inner one finishes.
+static void awaited_from_a_coroutine() {
+	event_loop              loop;
+	extended::map<int, int> m;
+	bool                    finished = false;
+	auto outer = [](extended::map<int, int>& m, event_loop& loop, bool& finished) -> extended::task {
+		std::vector<std::pair<int, int>> batch;
+		for (int i = 0; i < 300; ++i) {
+			batch.emplace_back(i, i % 2);
+		}
+		co_await m.apply_async(batch, loop.every(40));
+		co_await m.compact_async(loop.every(40));
+		finished = true;
+	};
+	extended::task running = outer(m, loop, finished);
+	running.start();
+	CHECK(!finished);
+	loop.run(running);
+	running.await_resume();
+	CHECK(finished);
+	CHECK(m.size() == 150);
+}
+
+// An exception in the operation is given to whoever awaits it.
+static void errors_reach_the_awaiter() {
+	auto failing = []() -> extended::task {
+		throw std::runtime_error("failed");
+		co_return;
+	};
+	extended::task running = failing();
+	running.start();
+	CHECK(running.done());
+	bool thrown = false;
+	try {
+		running.await_resume();
+	} catch (const std::runtime_error&) {
+		thrown = true;
+	}
+	CHECK(thrown);
+}
+
+// The string map has the same operations.
+static void string_map_operations() {
+	event_loop                      loop;
+	extended::map<int, std::string> m;
+	std::vector<std::pair<int, std::string>> batch;
+	for (int i = 0; i < 200; ++i) {
+		batch.emplace_back(i, (i % 2) ? std::to_string(i) : std::string());
+	}
+	extended::task applying = m.apply_async(batch, loop.every(16));
+	applying.start();
+	loop.run(applying);
+	applying.await_resume();
+	CHECK(m.size() == 100);
+	CHECK((m >> 7) == "7");
+	std::size_t read = 0;
+	auto reader = [](extended::map<int, std::string>& m, extended::pacing how, std::size_t& read) -> extended::task {
+		auto entries = m.entries_async(how);
+		while (auto item = co_await entries.next()) {
+			CHECK((*item).second == std::to_string((*item).first));
+			++read;
+		}
+	};
+	extended::task reading = reader(m, loop.every(16), read);
+	reading.start();
+	loop.run(reading);
+	CHECK(read == 100);
+}
+
+int main() {
+	no_post_runs_to_the_end();
+	apply_suspends_every_items();
+	compact_suspends_every_items();
+	compact_survives_changes_while_suspended();
+	entries_in_order_with_pacing();
+	awaited_from_a_coroutine();
+	errors_reach_the_awaiter();
+	string_map_operations();
+	return 0;
+}
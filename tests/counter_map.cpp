@@ -0,0 +1,57 @@
+#include "extended.h"
+#include "check.h"
+
+#include <string>
+#include <thread>
+#include <vector>
+
+// A count that comes back to the default takes no memory, add returns the new count each time.
+static void counts_erase_at_zero() {
+	extended::counter_map<std::string> m;
+	CHECK(m.add("a", 3) == 3);
+	CHECK(m.add("a", -1) == 2);
+	CHECK(m.add("b", 0) == 0);
+	CHECK(m.count("b") == 0); // adding nothing to a missing key makes no entry
+	CHECK(m.add("a", -2) == 0);
+	CHECK(m.empty());
+	CHECK((m >> "a") == 0);
+}
+
+// Counting starts from the default value of the map, and erases when it comes back to it.
+static void custom_default() {
+	extended::counter_map<int, double> m(1.0);
+	CHECK(m.add(1, 0.5) == 1.5);
+	CHECK(m.size() == 1);
+	CHECK(m.add(1, -0.5) == 1.0);
+	CHECK(m.empty());
+}
+
+// Many threads counting the same keys lose no increments, and operator! drops the counts that went back to zero.
+static void concurrent_counts() {
+	extended::concurrent_counter_map<int> m(0, 4);
+	std::vector<std::thread>              counters;
+	for (int t = 0; t < 4; ++t) {
+		counters.emplace_back([&m, t] {
+			for (int i = 0; i < 64 * 300; ++i) {
+				m.add(i % 64, 1);
+				m.add(1000 + t, (i % 2) ? 1 : -1); // a key per thread that ends at zero
+			}
+		});
+	}
+	for (auto& counter : counters) {
+		counter.join();
+	}
+	for (int key = 0; key < 64; ++key) {
+		CHECK((m >> key) == 4 * 300);
+	}
+	CHECK((m >> 1000) == 0);
+	!m;
+	CHECK(m.size() == 64);
+}
+
+int main() {
+	counts_erase_at_zero();
+	custom_default();
+	concurrent_counts();
+	return 0;
+}
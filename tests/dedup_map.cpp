@@ -0,0 +1,95 @@
+#include "extended.h"
+#include "check.h"
+
+#include <memory>
+#include <vector>
+
+/**
+ * \brief A large value that counts its live copies, to see what the pool keeps.
+ */
+struct record {
+	static int live;
+	std::vector<int> fields;
+	
+	record() { live++; }
+	record(std::vector<int> f) : fields(std::move(f)) { live++; }
+	record(const record& other) : fields(other.fields) { live++; }
+	record(record&& other) noexcept : fields(std::move(other.fields)) { live++; }
+	~record() { live--; }
+	record& operator= (const record&) = default;
+	record& operator= (record&&) = default;
+	bool operator== (const record& other) const { return fields == other.fields; }
+	bool operator!= (const record& other) const { return fields != other.fields; }
+};
+
+int record::live = 0;
+
+/**
+ * \brief A hash that puts every record in one bucket, so only \c operator== tells values apart.
+ */
+struct same_hash {
+	std::size_t operator() (const record&) const { return 42; }
+};
+
+using map  = extended::dedup_map<int, record, same_hash>;
+using pool = extended::value_pool<record, same_hash>;
+
+// Equal values under any key of any map sharing the pool are one object, unequal ones are not merged even with equal hashes.
+static void equal_values_are_one_object() {
+	auto shared = std::make_shared<pool>();
+	map  left(record(), shared);
+	map  right(record(), shared);
+	left << std::make_pair(1, record({1, 2, 3}));
+	left << std::make_pair(2, record({1, 2, 3}));
+	right << std::make_pair(9, record({1, 2, 3}));
+	right << std::make_pair(8, record({3, 2, 1}));
+	CHECK(&(left >> 1) == &(left >> 2));
+	CHECK(&(left >> 1) == &(right >> 9));
+	CHECK(&(left >> 1) != &(right >> 8));
+	CHECK((*shared).size() == 3); // the empty default, {1, 2, 3} and {3, 2, 1}
+}
+
+// The pool destroys a value once no entry holds it, erasing with the default value included.
+static void unused_values_are_destroyed() {
+	int before = record::live;
+	{
+		map m;
+		m << std::make_pair(1, record({7}));
+		m << std::make_pair(2, record({7}));
+		int holding = record::live;
+		m << std::make_pair(1, record());
+		CHECK(record::live == holding); // {7} is still held by key 2
+		m << std::make_pair(2, record());
+		CHECK(record::live == holding - 1);
+		CHECK(m.size() == 0);
+		
+		m(std::make_pair(3, record())); // operator() never adds a default entry
+		CHECK(m.size() == 0);
+	}
+	CHECK(record::live == before);
+}
+
+// operator! drops entries that operator() left at the default, and for_each gives the rest in key order.
+static void compaction_and_iteration() {
+	map m;
+	m << std::make_pair(3, record({3}));
+	m << std::make_pair(1, record({1}));
+	m << std::make_pair(2, record({2}));
+	m(std::make_pair(2, record()));
+	CHECK(m.size() == 3);
+	!m;
+	CHECK(m.size() == 2);
+	std::vector<int> keys;
+	m.for_each([&](int key, const record& value) {
+		CHECK(value.fields == std::vector<int>{key});
+		keys.push_back(key);
+	});
+	CHECK(keys == (std::vector<int>{1, 3}));
+}
+
+int main() {
+	equal_values_are_one_object();
+	unused_values_are_destroyed();
+	compaction_and_iteration();
+	return 0;
+}
@@ -0,0 +1,48 @@
+#include "extended.h"
+#include "check.h"
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+// Each answer lands at the position of its key, whatever order the keys came in and whichever path answered them.
+static void answers_line_up_with_keys() {
+	extended::map<int, int> m(-1);
+	for (int i = 0; i < 10000; i += 2) {
+		m << std::make_pair(i, i * 3);
+	}
+	std::mt19937 random(7);
+	for (std::size_t count : {0, 1, 10, 63, 64, 5000}) {
+		std::vector<int> keys(count);
+		for (auto& key : keys) {
+			key = (int)(random() % 10010);
+		}
+		for (bool sorted : {false, true}) {
+			if (sorted) {
+				std::sort(keys.begin(), keys.end());
+			}
+			std::vector<int> values(count, 12345);
+			m.get_many(keys.begin(), keys.end(), values.begin());
+			for (std::size_t i = 0; i < count; ++i) {
+				CHECK(values[i] == ((keys[i] % 2 == 0 && keys[i] < 10000) ? keys[i] * 3 : -1));
+			}
+		}
+	}
+}
+
+// Repeated keys in a sorted list each get the value, the walk does not move past them.
+static void repeated_sorted_keys() {
+	extended::map<int, std::string> m;
+	m << std::make_pair(5, std::string("five"));
+	std::vector<int>         keys{1, 5, 5, 5, 9};
+	std::vector<std::string> values(keys.size());
+	m.get_many(keys.begin(), keys.end(), values.begin());
+	CHECK(values == (std::vector<std::string>{"", "five", "five", "five", ""}));
+}
+
+int main() {
+	answers_line_up_with_keys();
+	repeated_sorted_keys();
+	return 0;
+}
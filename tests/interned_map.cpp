@@ -0,0 +1,75 @@
+#include "extended.h"
+#include "check.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+// A string is kept once however many maps use it, and freed when the last map lets go of it.
+static void maps_share_a_pool() {
+	auto                        pool = std::make_shared<extended::string_pool>();
+	extended::interned_map<int> colours(std::string(), pool);
+	{
+		extended::interned_map<int> shades(std::string(), pool);
+		colours << std::make_pair(1, std::string_view("red"));
+		shades << std::make_pair(1, std::string_view("red"));
+		shades << std::make_pair(2, std::string_view("crimson"));
+		CHECK((*pool).size() == 3); // "", "red" and "crimson"
+		CHECK((colours >> 1).data() == (shades >> 1).data()); // both views point at the one copy
+	}
+	CHECK((*pool).size() == 2); // "crimson" went with the map that held it
+	CHECK((colours >> 1) == "red");
+}
+
+// Writing the default string erases the key, and the pool drops a string no entry holds any more.
+static void default_string_erases() {
+	extended::interned_map<int> m("none");
+	m << std::make_pair(1, std::string_view("a"));
+	m << std::make_pair(2, std::string_view("a"));
+	m << std::make_pair(1, std::string_view("none"));
+	CHECK(m.size() == 1);
+	CHECK((m >> 1) == "none");
+	CHECK((*m.pool()).size() == 2);
+	m << std::make_pair(2, std::string_view("none"));
+	CHECK((*m.pool()).size() == 1);
+	
+	m(std::make_pair(3, std::string_view("none"))); // operator() never adds a default entry
+	CHECK(m.size() == 0);
+}
+
+// operator() may leave an entry at the default, operator! removes it by comparing handles.
+static void compaction_by_handle() {
+	extended::interned_map<int> m;
+	m << std::make_pair(1, std::string_view("a"));
+	m << std::make_pair(2, std::string_view("b"));
+	m(std::make_pair(1, std::string_view("")));
+	CHECK(m.size() == 2);
+	!m;
+	CHECK(m.size() == 1);
+	CHECK((*m.pool()).size() == 2);
+	
+	std::vector<std::pair<int, std::string>> seen;
+	m.for_each([&](int key, std::string_view value) { seen.emplace_back(key, std::string(value)); });
+	CHECK(seen == (std::vector<std::pair<int, std::string>>{{2, "b"}}));
+}
+
+// Freed handles are given out again, so a pool under churn stays the size of its live strings.
+static void handles_are_reused() {
+	extended::interned_map<int> m;
+	for (int round = 0; round < 100; ++round) {
+		for (int key = 0; key < 10; ++key) {
+			m << std::make_pair(key, std::string_view(std::to_string(round * 10 + key)));
+		}
+	}
+	CHECK(m.size() == 10);
+	CHECK((*m.pool()).size() == 11);
+	CHECK((m >> 3) == "993");
+}
+
+int main() {
+	maps_share_a_pool();
+	default_string_erases();
+	compaction_by_handle();
+	handles_are_reused();
+	return 0;
+}
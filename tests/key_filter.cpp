@@ -0,0 +1,70 @@
+#include "extended.h"
+#include "check.h"
+
+#include <string>
+#include <thread>
+#include <vector>
+
+// Every stored key is still found with the filter on, and most missing keys never reach the tree.
+static void no_false_negatives() {
+	extended::map<int, int> m;
+	for (int i = 0; i < 10000; ++i) {
+		m << std::make_pair(i * 2, i + 1);
+	}
+	m.use_filter();
+	for (int i = 0; i < 10000; ++i) {
+		CHECK((m >> (i * 2)) == i + 1);
+	}
+	for (int i = 0; i < 10000; ++i) {
+		CHECK((m >> (i * 2 + 1)) == 0);
+	}
+	auto stats = m.stats();
+	CHECK(stats.lookups == 20000);
+	CHECK(stats.skipped + stats.false_positives == 10000);
+	CHECK(stats.false_positive_rate() < 0.05);
+}
+
+// Keys added after the filter was built, including past the size it was built for, are found.
+static void follows_later_writes() {
+	extended::map<std::string, int> m;
+	m.use_filter();
+	for (int i = 0; i < 5000; ++i) {
+		m << std::make_pair(std::to_string(i), i + 1);
+		m(std::make_pair("x" + std::to_string(i), i + 1));
+	}
+	for (int i = 0; i < 5000; ++i) {
+		CHECK((m >> std::to_string(i)) == i + 1);
+		CHECK((m >> ("x" + std::to_string(i))) == i + 1);
+	}
+	m.use_filter(false);
+	CHECK(m.stats().lookups == 0);
+	CHECK((m >> "42") == 43);
+}
+
+// Several threads may read a map at once with the filter on, the counters add up exactly.
+static void shared_readers_count_exactly() {
+	extended::map<int, int> m;
+	for (int i = 0; i < 1000; ++i) {
+		m << std::make_pair(i, 1);
+	}
+	m.use_filter();
+	std::vector<std::thread> readers;
+	for (int t = 0; t < 4; ++t) {
+		readers.emplace_back([&m] {
+			for (int i = 0; i < 20000; ++i) {
+				(void)(m >> (i % 2000));
+			}
+		});
+	}
+	for (auto& reader : readers) {
+		reader.join();
+	}
+	CHECK(m.stats().lookups == 80000);
+}
+
+int main() {
+	no_false_negatives();
+	follows_later_writes();
+	shared_readers_count_exactly();
+	return 0;
+}
@@ -0,0 +1,56 @@
+#include "extended.h"
+#include "check.h"
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+using extended::execution;
+
+static extended::map<int, int64_t> numbers(int count) {
+	extended::map<int, int64_t> m;
+	for (int i = 1; i <= count; ++i) {
+		m << std::make_pair(i, (int64_t)i);
+	}
+	return m;
+}
+
+// Both policies visit every entry once and agree on the result, the parallel one only splits maps past its threshold.
+static void policies_agree() {
+	for (int count : {100, 1 << 17}) {
+		for (execution how : {execution::sequential, execution::parallel}) {
+			auto                 m = numbers(count);
+			std::atomic<int64_t> seen{0};
+			m.for_each(how, [&](int, int64_t value) { seen += value; });
+			int64_t expected = (int64_t)count * (count + 1) / 2;
+			CHECK(seen.load() == expected);
+			CHECK(m.reduce(how, (int64_t)0, [](int, int64_t value) { return value; }, [](int64_t a, int64_t b) { return a + b; }) == expected);
+			
+			// Every third value becomes the default and is erased, the rest are doubled.
+			m.transform_values(how, [](int key, int64_t value) { return (key % 3 == 0) ? 0 : value * 2; });
+			CHECK((int)m.size() == count - count / 3);
+			CHECK((m >> 3) == 0);
+			CHECK(m.count(3) == 0);
+			CHECK((m >> 4) == 8);
+		}
+	}
+}
+
+// reduce keeps key order within and across ranges, so a combine that is associative but not commutative still works.
+static void reduce_keeps_order() {
+	extended::map<int, std::string> m;
+	for (int i = 0; i < (1 << 15); ++i) {
+		m << std::make_pair(i, std::string(1, (char)('a' + i % 26)));
+	}
+	auto concat = [](std::string a, const std::string& b) { return a + b; };
+	auto serial = m.reduce(execution::sequential, std::string(), [](int, const std::string& v) { return v; }, concat);
+	auto split  = m.reduce(execution::parallel, std::string(), [](int, const std::string& v) { return v; }, concat);
+	CHECK(serial.size() == m.size());
+	CHECK(serial == split);
+}
+
+int main() {
+	policies_agree();
+	reduce_keeps_order();
+	return 0;
+}
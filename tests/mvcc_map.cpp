@@ -0,0 +1,157 @@
+#include "extended.h"
+#include "check.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+/**
+ * \brief Opens up the version chains so the test can see what operator! drops.
+ */
+struct watched : extended::mvcc_map<int, int> {
+	using mvcc_map::mvcc_map;
+
+	std::size_t versions(int key) const {
+		std::shared_lock<std::shared_mutex> hold(data_lock);
+		auto it = data.find(key);
+		return (it == data.end()) ? 0 : (*it).second.size();
+	}
+};
+
+// operator<< erases on a default value, operator() keeps the entry at the default until operator!.
+static void write_semantics() {
+	watched m(0);
+	m << std::make_pair(1, 10);
+	m << std::make_pair(2, 20);
+	m << std::make_pair(3, 0); // never adds a default entry
+	CHECK(m.size() == 2);
+	CHECK((m >> 1) == 10);
+	CHECK((m >> 3) == 0);
+	m << std::make_pair(1, 0);
+	CHECK(m.size() == 1);
+	m(std::make_pair(2, 0));
+	CHECK(m.size() == 1);
+	CHECK((m >> 2) == 0);
+	!m;
+	CHECK(m.size() == 0);
+	CHECK(m.versions(2) == 0);
+}
+
+// A snapshot keeps reading the values of its time while the map is written, erased and compacted.
+static void snapshot_keeps_its_time() {
+	watched m(0);
+	for (int key = 0; key < 1000; ++key) {
+		m << std::make_pair(key, key + 1);
+	}
+	auto before = m.pin();
+	for (int key = 0; key < 1000; key += 2) {
+		m << std::make_pair(key, 0); // erase the even keys
+	}
+	m << std::make_pair(5000, 1); // and add one the snapshot must not see
+	!m;
+	CHECK((m >> 0) == 0);
+	CHECK((before >> 0) == 1);
+	CHECK((before >> 5000) == 0);
+	std::vector<int> keys;
+	before.for_each([&](int key, int value) {
+		CHECK(value == key + 1);
+		keys.push_back(key);
+	});
+	CHECK(keys.size() == 1000); // the scan reads several steps and still sees every key of its time
+	for (std::size_t i = 0; i < keys.size(); ++i) {
+		CHECK(keys[i] == (int)i);
+	}
+	auto after = m.pin();
+	std::size_t live = 0;
+	after.for_each([&](int key, int) {
+		CHECK((key % 2 == 1) || (key == 5000));
+		++live;
+	});
+	CHECK(live == 501);
+}
+
+// Old versions stay while a snapshot can see them, and operator! drops them once it is gone.
+static void compaction_follows_snapshots() {
+	watched m(0);
+	m << std::make_pair(1, 1);
+	{
+		auto pinned = m.pin();
+		m << std::make_pair(1, 2);
+		m << std::make_pair(1, 3);
+		m << std::make_pair(2, 7);
+		m << std::make_pair(2, 0);
+		!m;
+		CHECK(m.versions(1) == 3); // the pinned version and the two after it
+		CHECK((pinned >> 1) == 1);
+		CHECK((m >> 1) == 3);
+		CHECK(m.size() == 2); // the erase of 2 is only a version while pinned
+	}
+	!m;
+	CHECK(m.versions(1) == 1);
+	CHECK(m.size() == 1);
+	CHECK((m >> 1) == 3);
+}
+
+// A snapshot scan sees one state however many writes happen while it runs.
+static void scans_are_consistent_under_writes() {
+	const int                keys = 1000;
+	watched                  m(0);
+	std::atomic<int>         running{3};
+	std::atomic<int>         torn{0};
+	std::atomic<int>         rounds{0};
+	for (int key = 0; key < keys; ++key) {
+		m << std::make_pair(key, 1);
+	}
+	std::vector<std::thread> readers;
+	for (int t = 0; t < 3; ++t) {
+		readers.emplace_back([&] {
+			for (int scan = 0; scan < 20; ++scan) {
+				int  start  = rounds.load();
+				auto pinned = m.pin();
+				while (rounds.load() < start + 2) {
+					std::this_thread::yield(); // a whole round is written after the snapshot before it is scanned
+				}
+				int  high   = 0;
+				int  low    = 0;
+				int  seen   = 0;
+				bool order  = true;
+				pinned.for_each([&](int, int value) {
+					if (seen == 0) {
+						high = low = value;
+					}
+					order = order && (value <= low); // the writer goes up the keys, so a state only steps down once
+					low = value;
+					++seen;
+				});
+				if ((seen != keys) || !order || (high - low > 1) || ((pinned >> keys - 1) != low) || ((m >> 0) <= high)) { // and the map itself has moved on
+					torn++;
+				}
+				std::this_thread::yield(); // let the writer in between scans
+			}
+			running--;
+		});
+	}
+	for (int round = 2; running.load() > 0; ++round) {
+		for (int key = 0; key < keys; ++key) {
+			m << std::make_pair(key, round);
+		}
+		if (round % 10 == 0) {
+			!m;
+		}
+		rounds++;
+	}
+	for (auto& reader : readers) {
+		reader.join();
+	}
+	CHECK(torn.load() == 0);
+	!m;
+	CHECK(m.versions(0) == 1);
+}
+
+int main() {
+	write_semantics();
+	snapshot_keeps_its_time();
+	compaction_follows_snapshots();
+	scans_are_consistent_under_writes();
+	return 0;
+}
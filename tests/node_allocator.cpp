@@ -0,0 +1,143 @@
+#include "extended.h"
+#include "check.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <future>
+#include <new>
+#include <set>
+#include <thread>
+#include <utility>
+
+// Counts the calls to the global operator new, to see which maps still reach the heap.
+static std::atomic<std::size_t> news{0};
+
+void* operator new(std::size_t bytes) {
+	news++;
+	if (void* out = std::malloc(bytes ? bytes : 1)) {
+		return out;
+	}
+	throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept {
+	std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+	std::free(memory);
+}
+
+// An erased node is the next node of its size to be given out.
+static void erased_nodes_are_reused() {
+	extended::pooled::map<int, int> m;
+	m << std::make_pair(1, 10);
+	m << std::make_pair(2, 20);
+	const void* node = &*m.find(1);
+	m << std::make_pair(1, 0);
+	m << std::make_pair(3, 30);
+	CHECK(&*m.find(3) == node);
+	CHECK((m >> 2) == 20);
+	CHECK((m >> 3) == 30);
+}
+
+// Once warmed up, setting, erasing and re-adding keys never reaches operator new, unlike the plain map.
+static void churn_skips_the_heap() {
+	extended::pooled::map<int, int> pooled;
+	extended::map<int, int>         plain;
+	for (int key = 0; key < 1000; ++key) {
+		pooled << std::make_pair(key, 1);
+		plain << std::make_pair(key, 1);
+	}
+	std::size_t start = news.load();
+	for (int round = 0; round < 20; ++round) {
+		for (int key = round % 2; key < 1000; key += 2) {
+			pooled << std::make_pair(key, 0);
+		}
+		for (int key = round % 2; key < 1000; key += 2) {
+			pooled << std::make_pair(key, round + 2);
+		}
+	}
+	CHECK(news.load() == start);
+	CHECK(pooled.size() == 1000);
+	for (int round = 0; round < 20; ++round) {
+		for (int key = round % 2; key < 1000; key += 2) {
+			plain << std::make_pair(key, 0);
+		}
+		for (int key = round % 2; key < 1000; key += 2) {
+			plain << std::make_pair(key, round + 2);
+		}
+	}
+	CHECK(news.load() - start >= 20 * 500); // the plain map allocates every node it adds back
+	CHECK(std::equal(pooled.begin(), pooled.end(), plain.begin()));
+}
+
+// Nodes made on one thread and freed on another go to the freeing thread and are handed out there next.
+static void nodes_move_to_the_freeing_thread() {
+	auto*                 m = new extended::pooled::map<int, int>();
+	std::set<const void*> made;
+	std::promise<void>    built;
+	std::promise<void>    finished;
+	std::thread builder([&] {
+		for (int key = 0; key < 100; ++key) {
+			(*m) << std::make_pair(key, key + 1);
+			made.insert(&*(*m).find(key));
+		}
+		built.set_value();
+		finished.get_future().wait(); // stays alive, so the other thread cannot be given this slab
+	});
+	built.get_future().wait();
+	std::thread other([&] {
+		for (int key = 0; key < 100; ++key) {
+			(*m) << std::make_pair(key, 0); // erased here, not on the builder thread
+		}
+		CHECK((*m).empty());
+		for (int key = 0; key < 100; ++key) {
+			(*m) << std::make_pair(key + 500, 1);
+			CHECK(made.count(&*(*m).find(key + 500)) == 1);
+		}
+		delete m;
+	});
+	other.join();
+	finished.set_value();
+	builder.join();
+}
+
+// Maps can be moved and swapped freely, since every copy of the allocator is equal.
+static void moves_and_swaps_keep_nodes() {
+	extended::pooled::map<int, int> a;
+	extended::pooled::map<int, int> b;
+	a << std::make_pair(1, 1);
+	b << std::make_pair(2, 2);
+	const void* node = &*a.find(1);
+	a.swap(b);
+	CHECK(&*b.find(1) == node);
+	extended::pooled::map<int, int> c(std::move(b));
+	CHECK(&*c.find(1) == node);
+	CHECK(extended::node_allocator<int>() == extended::node_allocator<double>());
+}
+
+/**
+ * \brief A type aligned past what the slab gives.
+ */
+struct alignas(64) wide {
+	char bytes[64];
+};
+
+// Over aligned types bypass the slab and keep their alignment.
+static void over_aligned_types() {
+	extended::node_allocator<wide> allocator;
+	wide* block = allocator.allocate(1);
+	CHECK(((std::uintptr_t)block % 64) == 0);
+	allocator.deallocate(block, 1);
+}
+
+int main() {
+	erased_nodes_are_reused();
+	churn_skips_the_heap();
+	nodes_move_to_the_freeing_thread();
+	moves_and_swaps_keep_nodes();
+	over_aligned_types();
+	return 0;
+}
@@ -0,0 +1,72 @@
+#include "extended.h"
+#include "check.h"
+
+#include <cstdint>
+#include <cstring>
+#include <map>
+
+// Node placed pages can be written end to end and given back, on any node the machine reports.
+static void pages_on_every_node() {
+	int nodes = extended::numa::nodes();
+	CHECK(nodes >= 1);
+	CHECK((extended::numa::current() >= 0) && (extended::numa::current() < nodes));
+	for (int node = -1; node < nodes; ++node) {
+		std::size_t bytes  = 1 << 16;
+		void*       memory = extended::numa::allocate(bytes, node);
+		CHECK(memory != nullptr);
+		CHECK((uintptr_t)memory % 64 == 0);
+		std::memset(memory, 0xab, bytes);
+		extended::numa::release(memory, bytes);
+	}
+}
+
+// A freed block is the next one given out for its size class, larger blocks bypass the slab.
+static void blocks_are_recycled() {
+	extended::slab pool(0);
+	CHECK(pool.home() == 0);
+	void* first  = pool.allocate(40);
+	void* second = pool.allocate(48); // the same 48 byte class
+	CHECK((uintptr_t)first % 16 == 0);
+	CHECK(first != second);
+	pool.deallocate(first, 40);
+	CHECK(pool.allocate(33) == first);
+	void* large = pool.allocate(4096);
+	std::memset(large, 0, 4096);
+	pool.deallocate(large, 4096);
+	pool.deallocate(first, 33);
+	pool.deallocate(second, 48);
+}
+
+// A std::map on a slab reuses the nodes of erased keys instead of growing.
+static void map_on_a_slab() {
+	extended::slab pool;
+	{
+		using entry = std::pair<const int, int>;
+		std::map<int, int, std::less<int>, extended::slab_allocator<entry>> m{extended::slab_allocator<entry>(&pool)};
+		for (int i = 0; i < 1000; ++i) {
+			m.emplace(i, i);
+		}
+		const int* before = &m.at(999);
+		m.erase(999);
+		m.emplace(5000, 1);
+		CHECK(&m.at(5000) == before);
+		CHECK(m.size() == 1000);
+	}
+}
+
+// node_of names a node the map is on, or -1 when there is only one.
+static void shards_know_their_node() {
+	extended::concurrent_map<int, int> m(0, 8);
+	for (int key = 0; key < 100; ++key) {
+		int node = m.node_of(key);
+		CHECK((node == -1) || ((node >= 0) && (node < extended::numa::nodes())));
+	}
+}
+
+int main() {
+	pages_on_every_node();
+	blocks_are_recycled();
+	map_on_a_slab();
+	shards_know_their_node();
+	return 0;
+}
@@ -0,0 +1,61 @@
+#include "extended.h"
+#include "check.h"
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+// Runs of one key long enough to cross every range the build is cut into still keep only their last pair.
+static void repeated_keys_across_cuts() {
+	std::vector<std::pair<int, int>> items;
+	for (int key = 0; key < 8; ++key) {
+		for (int i = 0; i < 40000; ++i) {
+			items.emplace_back(key, i);
+		}
+	}
+	extended::map<int, int> m(0, items.begin(), items.end(), extended::bulk{true, true, 6});
+	CHECK(m.size() == 8);
+	for (int key = 0; key < 8; ++key) {
+		CHECK((m >> key) == 39999);
+	}
+}
+
+// A parallel sort and build of shuffled input gives the same map as the sequential one.
+static void shuffled_input_matches() {
+	std::vector<std::pair<int, std::string>> items;
+	for (int i = 0; i < 200000; ++i) {
+		items.emplace_back(i % 150000, (i % 5) ? std::to_string(i) : std::string());
+	}
+	std::shuffle(items.begin(), items.end(), std::mt19937(3));
+	extended::map<int, std::string> serial(std::string(), items.begin(), items.end(), extended::bulk{false, false});
+	extended::map<int, std::string> split(std::string(), items.begin(), items.end(), extended::bulk{false, true});
+	CHECK(serial.size() == split.size());
+	CHECK(std::equal(serial.begin(), serial.end(), split.begin()));
+}
+
+// A parallel compaction erases exactly what a sequential one does.
+static void parallel_compaction() {
+	extended::map<int, int> serial;
+	extended::map<int, int> split;
+	for (int i = 0; i < 300000; ++i) {
+		serial << std::make_pair(i, i + 1);
+		split << std::make_pair(i, i + 1);
+	}
+	for (int i = 0; i < 300000; i += 7) {
+		serial(std::make_pair(i, 0));
+		split(std::make_pair(i, 0));
+	}
+	serial.compact(1);
+	split.compact(4);
+	CHECK(split.size() == 300000 - (300000 + 6) / 7);
+	CHECK(serial.size() == split.size());
+	CHECK(std::equal(serial.begin(), serial.end(), split.begin()));
+}
+
+int main() {
+	repeated_keys_across_cuts();
+	shuffled_input_matches();
+	parallel_compaction();
+	return 0;
+}
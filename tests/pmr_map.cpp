@@ -0,0 +1,109 @@
+#include "extended.h"
+#include "check.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory_resource>
+#include <vector>
+
+/**
+ * \brief A resource that counts what it gives out and passes the work on to another resource.
+ */
+class spy : public std::pmr::memory_resource {
+	protected:
+		std::pmr::memory_resource* upstream;
+		
+		void* do_allocate(std::size_t bytes, std::size_t align) override {
+			live++;
+			total++;
+			return (*upstream).allocate(bytes, align);
+		}
+		void do_deallocate(void* memory, std::size_t bytes, std::size_t align) override {
+			live--;
+			(*upstream).deallocate(memory, bytes, align);
+		}
+		bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+			return this == &other;
+		}
+	public:
+		std::atomic<long> live{0};
+		std::atomic<long> total{0};
+		
+		spy(std::pmr::memory_resource* to) : upstream(to) {}
+};
+
+using resource = std::pmr::polymorphic_allocator<std::pair<const int, int>>;
+
+static std::vector<std::pair<int, int>> pairs(int count) {
+	std::vector<std::pair<int, int>> out;
+	out.reserve(count);
+	for (int i = 0; i < count; ++i) {
+		out.emplace_back(i, (i % 7) ? i : 0); // every seventh value is the default and must be dropped
+	}
+	return out;
+}
+
+// The parallel bulk path must allocate every node from the map's own resource, and never from the default one.
+static void bulk_parallel_uses_the_resource() {
+	std::pmr::unsynchronized_pool_resource pool;
+	spy                                    counted(&pool);
+	auto                                   items = pairs(1 << 18);
+	{
+		extended::pmr::map<int, int> m(0, items.begin(), items.end(), extended::bulk{true, true, 4}, resource(&counted));
+		std::size_t kept = items.size() - (items.size() + 6) / 7;
+		CHECK(m.size() == kept);
+		CHECK(counted.live.load() == (long)kept);
+		for (int i = 0; i < (int)items.size(); i += 1001) {
+			CHECK((m >> i) == ((i % 7) ? i : 0));
+		}
+		CHECK(m.get_allocator().resource() == &counted);
+	}
+	CHECK(counted.live.load() == 0); // every node went back to the resource it came from
+}
+
+// Unsorted input goes through the sort first, the nodes still come from the resource.
+static void bulk_unsorted_uses_the_resource() {
+	std::pmr::monotonic_buffer_resource arena;
+	spy                                 counted(&arena);
+	auto                                items = pairs(1 << 17);
+	std::reverse(items.begin(), items.end());
+	extended::pmr::map<int, int> m(0, items.begin(), items.end(), extended::bulk{false, true, 0}, resource(&counted));
+	CHECK(counted.total.load() >= (long)m.size());
+	CHECK(std::is_sorted(m.begin(), m.end()));
+}
+
+// An allocator whose copies are all equal still builds in parallel, with the same result as the sequential build.
+static void bulk_parallel_matches_sequential() {
+	auto                    items = pairs(1 << 18);
+	extended::map<int, int> serial(0, items.begin(), items.end(), extended::bulk{true, false, 1});
+	extended::map<int, int> split(0, items.begin(), items.end(), extended::bulk{true, true, 4});
+	CHECK(serial.size() == split.size());
+	CHECK(std::equal(serial.begin(), serial.end(), split.begin()));
+}
+
+// A transaction keeps its updates on the map's resource as well, nothing comes from the global heap.
+static void transaction_uses_the_resource() {
+	std::pmr::monotonic_buffer_resource arena;
+	spy                                 counted(&arena);
+	extended::pmr::map<int, int>        m(0, resource(&counted));
+	std::pmr::set_default_resource(std::pmr::null_memory_resource());
+	{
+		auto tx = m.begin_transaction();
+		for (int i = 1; i <= 100; ++i) {
+			tx << std::make_pair(i, i);
+		}
+		CHECK(counted.live.load() == 100);
+		tx.commit();
+	}
+	std::pmr::set_default_resource(nullptr);
+	CHECK(m.size() == 100);
+	CHECK((m >> 50) == 50);
+}
+
+int main() {
+	bulk_parallel_uses_the_resource();
+	bulk_unsorted_uses_the_resource();
+	bulk_parallel_matches_sequential();
+	transaction_uses_the_resource();
+	return 0;
+}
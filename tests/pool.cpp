@@ -0,0 +1,78 @@
+#include "pool.h"
+#include "check.h"
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+static void runs_every_index_once() {
+	extended::pool   workers(4);
+	std::vector<int> hits(100000, 0);
+	workers.run(hits.size(), [&](std::size_t i) { hits[i]++; });
+	for (int hit : hits) {
+		CHECK(hit == 1);
+	}
+}
+
+// Every worker has to pick up a task for the round to finish, so a worker that sleeps through a submit shows up as a timeout.
+static void sleeping_workers_wake_up() {
+	extended::pool workers(3);
+	for (int round = 0; round < 200; ++round) {
+		std::atomic<int> arrived{0};
+		std::atomic<int> late{0};
+		workers.run(4, [&](std::size_t) {
+			arrived++;
+			auto limit = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+			while (arrived.load() < 4) {
+				if (std::chrono::steady_clock::now() > limit) {
+					late++;
+					return;
+				}
+				std::this_thread::yield();
+			}
+		});
+		CHECK(late.load() == 0);
+		std::this_thread::sleep_for(std::chrono::microseconds(200)); // let the workers go back to sleep
+	}
+}
+
+static void runs_nest() {
+	extended::pool   workers(4);
+	std::atomic<int> total{0};
+	workers.run(16, [&](std::size_t) {
+		workers.run(16, [&](std::size_t) { total++; });
+	});
+	CHECK(total.load() == 256);
+}
+
+static void errors_reach_the_caller() {
+	extended::pool   workers(4);
+	std::atomic<int> ran{0};
+	bool             caught = false;
+	try {
+		workers.run(1000, [&](std::size_t i) {
+			ran++;
+			if (i == 500) {
+				throw std::runtime_error("index 500");
+			}
+		});
+	} catch (const std::runtime_error&) {
+		caught = true;
+	}
+	CHECK(caught);
+	CHECK(ran.load() <= 1000);
+	
+	std::atomic<int> after{0};
+	workers.run(1000, [&](std::size_t) { after++; });
+	CHECK(after.load() == 1000); // the pool still works after a failed run
+}
+
+int main() {
+	runs_every_index_once();
+	sleeping_workers_wake_up();
+	runs_nest();
+	errors_reach_the_caller();
+	return 0;
+}
@@ -0,0 +1,80 @@
+#include "extended.h"
+#include "check.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+/**
+ * \brief Opens up the retired list so the test can see when old versions are freed.
+ */
+struct watched : extended::rcu_map<int, int> {
+	using rcu_map::rcu_map;
+	
+	std::size_t retired_versions() const {
+		std::lock_guard<std::mutex> hold(lock);
+		return retired.size();
+	}
+};
+
+// Writes wait for publish, a default value erases, and a snapshot keeps the version it pinned.
+static void versions_and_snapshots() {
+	watched m(0);
+	m << std::make_pair(1, 10);
+	CHECK((m >> 1) == 0);
+	m.publish();
+	CHECK((m >> 1) == 10);
+	CHECK(m.retired_versions() == 0); // no reader was in the first version
+	{
+		auto pinned = m.pin();
+		m << std::make_pair(1, 0);
+		m << std::make_pair(2, 20);
+		m.publish();
+		CHECK((pinned >> 1) == 10);
+		CHECK((pinned >> 2) == 0);
+		CHECK((m >> 1) == 0);
+		CHECK(m.pin()->count(1) == 0); // the erase left no entry behind
+		CHECK(m.retired_versions() == 1); // the pinned version waits for its snapshot
+	}
+	CHECK(m.retired_versions() == 0); // and goes when the snapshot ends, not at the next publish
+}
+
+// Readers never block and always see a whole version while a writer keeps publishing.
+static void readers_during_publish() {
+	watched                  m(0);
+	std::atomic<bool>        done{false};
+	std::atomic<int>         torn{0};
+	std::vector<std::thread> readers;
+	for (int t = 0; t < 3; ++t) {
+		readers.emplace_back([&] {
+			while (!done.load()) {
+				auto pinned = m.pin();
+				int  first  = pinned >> 0;
+				for (int key = 1; key < 16; ++key) {
+					if ((pinned >> key) != first) {
+						torn++;
+					}
+				}
+			}
+		});
+	}
+	for (int version = 1; version <= 300; ++version) {
+		for (int key = 0; key < 16; ++key) {
+			m << std::make_pair(key, version);
+		}
+		m.publish();
+	}
+	done = true;
+	for (auto& reader : readers) {
+		reader.join();
+	}
+	CHECK(torn.load() == 0);
+	m.publish();
+	CHECK(m.retired_versions() == 0);
+}
+
+int main() {
+	versions_and_snapshots();
+	readers_during_publish();
+	return 0;
+}
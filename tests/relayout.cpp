@@ -0,0 +1,124 @@
+#include "extended.h"
+#include "check.h"
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+/**
+ * \brief Builds a map in random key order with other allocations kept alive between its nodes, so an in order scan jumps around memory.
+ */
+template <class Map, class Value>
+static std::vector<std::unique_ptr<char[]>> scatter(Map& m, int count, Value value) {
+	std::mt19937                        random(47);
+	std::vector<int>                    keys(count);
+	std::vector<std::unique_ptr<char[]>> junk;
+	for (int i = 0; i < count; ++i) {
+		keys[i] = i;
+	}
+	std::shuffle(keys.begin(), keys.end(), random);
+	for (int key : keys) {
+		m << std::make_pair(key, value(key));
+		junk.emplace_back(new char[64 + random() % 192]);
+	}
+	return junk;
+}
+
+// Relayout keeps the contents and leaves an in order scan on far fewer pages.
+static void scattered_map_is_laid_out_again() {
+	extended::map<int, int> m;
+	auto                    junk = scatter(m, 20000, [](int key) { return key + 1; });
+	std::map<int, int> contents(m.begin(), m.end());
+	extended::layout_stats measured = m.layout();
+	auto [before, after] = m.relayout();
+	CHECK(before.entries == measured.entries);
+	CHECK(before.page_jumps == measured.page_jumps);
+	CHECK(after.entries == 20000);
+	CHECK(after.node_bytes == before.node_bytes);
+	CHECK(after.fragmentation() * 4 < before.fragmentation()); // random order jumps almost every step, the new nodes sit together
+	CHECK(after.span_bytes <= before.span_bytes);
+	CHECK(std::equal(m.begin(), m.end(), contents.begin(), contents.end()));
+	junk.clear(); // the holes between the old nodes are free now, so copies made into them would be scattered again
+	auto [again, same] = m.relayout();
+	CHECK(same.page_jumps <= again.page_jumps); // and then the laid out nodes are kept
+	CHECK(same.span_bytes <= again.span_bytes);
+	CHECK(std::equal(m.begin(), m.end(), contents.begin(), contents.end()));
+}
+
+// With compact the default values operator() left are dropped in the same pass, without it they stay.
+static void compact_drops_default_values() {
+	extended::map<int, int> m;
+	for (int key = 0; key < 1000; ++key) {
+		m << std::make_pair(key, 1);
+	}
+	for (int key = 0; key < 1000; key += 3) {
+		m(std::make_pair(key, 0));
+	}
+	auto kept = m.relayout(false);
+	CHECK(kept.second.entries == 1000);
+	CHECK(m.size() == 1000);
+	auto compacted = m.relayout();
+	CHECK(compacted.first.entries == 1000);
+	CHECK(compacted.second.entries == 666);
+	for (auto& entry : m) {
+		CHECK(entry.first % 3 != 0);
+		CHECK(entry.second == 1);
+	}
+}
+
+// The key filter is rebuilt when compacting, so it stays right about the keys left.
+static void filter_follows_compaction() {
+	extended::map<int, int> m;
+	m.use_filter();
+	for (int key = 0; key < 5000; ++key) {
+		m << std::make_pair(key, 1);
+	}
+	for (int key = 0; key < 5000; key += 2) {
+		m(std::make_pair(key, 0));
+	}
+	m.relayout();
+	for (int key = 0; key < 5000; ++key) {
+		CHECK((m >> key) == key % 2);
+	}
+}
+
+// Empty and single entry maps measure as not fragmented at all.
+static void small_maps() {
+	extended::map<int, int> m;
+	CHECK(m.layout().entries == 0);
+	CHECK(m.layout().span_bytes == 0);
+	CHECK(m.layout().fragmentation() == 0.0);
+	m << std::make_pair(1, 1);
+	auto [before, after] = m.relayout();
+	CHECK(before.fragmentation() == 0.0);
+	CHECK(after.entries == 1);
+	CHECK(after.span_bytes == after.node_bytes);
+	CHECK((m >> 1) == 1);
+}
+
+// The string map copies its values too, so the contents stay the same.
+static void string_values_are_copied() {
+	extended::map<int, std::string> m;
+	auto junk = scatter(m, 5000, [](int key) { return std::string(40, (char)('a' + key % 26)); });
+	std::map<int, std::string> contents(m.begin(), m.end());
+	auto [before, after] = m.relayout();
+	CHECK(after.fragmentation() <= before.fragmentation());
+	CHECK(std::equal(m.begin(), m.end(), contents.begin(), contents.end()));
+	for (int round = 0; round < 3; ++round) {
+		auto [was, now] = m.relayout();
+		CHECK(now.page_jumps <= was.page_jumps); // never worse, whatever the allocator hands out
+	}
+	CHECK(std::equal(m.begin(), m.end(), contents.begin(), contents.end()));
+}
+
+int main() {
+	scattered_map_is_laid_out_again();
+	compact_drops_default_values();
+	filter_follows_compaction();
+	small_maps();
+	string_values_are_copied();
+	return 0;
+}
@@ -0,0 +1,82 @@
+#include "extended.h"
+#include "check.h"
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+/**
+ * \brief A two word value whose halves must always match, a torn read would break that.
+ */
+struct pair_words {
+	uint64_t low;
+	uint64_t high;
+	
+	pair_words(uint64_t v) : low(v), high(~v) {} // no default constructor on purpose
+	bool operator== (const pair_words& other) const { return (low == other.low) && (high == other.high); }
+	bool operator!= (const pair_words& other) const { return !((*this) == other); }
+	bool whole() const { return high == ~low; }
+};
+
+// Readers race with writers that also grow the tables, and never see a torn value or a value of another key.
+static void readers_never_see_torn_values() {
+	extended::seqlock_map<uint64_t, pair_words> m(pair_words(0), 4);
+	std::atomic<bool>                           done{false};
+	std::atomic<int>                            bad{0};
+	std::vector<std::thread>                    readers;
+	for (int t = 0; t < 3; ++t) {
+		readers.emplace_back([&] {
+			while (!done.load()) {
+				for (uint64_t key = 0; key < 20000; key += 13) {
+					pair_words value = m >> key;
+					if (!value.whole() || ((value.low != 0) && (value.low % 100000 != key))) {
+						bad++;
+					}
+				}
+			}
+		});
+	}
+	for (uint64_t round = 1; round <= 5; ++round) {
+		for (uint64_t key = 0; key < 20000; ++key) {
+			m << std::make_pair(key, pair_words(round * 100000 + key));
+		}
+		for (uint64_t key = 0; key < 20000; key += 3) {
+			m << std::make_pair(key, pair_words(0));
+		}
+	}
+	done = true;
+	for (auto& reader : readers) {
+		reader.join();
+	}
+	CHECK(bad.load() == 0);
+	CHECK((m >> 1).low == 500001);
+	CHECK((m >> 3).low == 0);
+	CHECK(m.size() == 20000 - (20000 + 2) / 3);
+}
+
+// operator() keeps an entry at the default, operator! removes it, erased slots do not hide later keys.
+static void compaction_and_reuse() {
+	extended::seqlock_map<int, double> m(-1.0, 1);
+	for (int i = 0; i < 100; ++i) {
+		m << std::make_pair(i, i * 0.5);
+	}
+	for (int i = 0; i < 100; i += 2) {
+		m(std::make_pair(i, -1.0));
+	}
+	CHECK(m.size() == 100);
+	!m;
+	CHECK(m.size() == 50);
+	for (int i = 0; i < 100; ++i) {
+		CHECK((m >> i) == ((i % 2) ? i * 0.5 : -1.0));
+	}
+	m << std::make_pair(4, 2.0);
+	CHECK((m >> 4) == 2.0);
+	CHECK(m.size() == 51);
+}
+
+int main() {
+	readers_never_see_torn_values();
+	compaction_and_reuse();
+	return 0;
+}
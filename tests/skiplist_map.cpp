@@ -0,0 +1,106 @@
+#include "extended.h"
+#include "check.h"
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * \brief Opens up the retired count so the test can see that memory is freed without \c operator! .
+ */
+struct watched : extended::skiplist_map<int, std::string> {
+	using skiplist_map::skiplist_map;
+	
+	std::size_t waiting() const {
+		return backlog.load();
+	}
+};
+
+// Scans see live entries in key order and skip erased ones, operator! drops the entries left at the default.
+static void ordered_scans() {
+	extended::skiplist_map<int, int> m;
+	for (int i = 100; i > 0; --i) {
+		m << std::make_pair(i, i * 2);
+	}
+	for (int i = 1; i <= 100; i += 3) {
+		m << std::make_pair(i, 0);
+	}
+	m(std::make_pair(2, 0));
+	int last  = 0;
+	int count = 0;
+	m.scan(10, 50, [&](int key, int value) {
+		CHECK((key >= 10) && (key < 50) && (key > last));
+		CHECK(value == key * 2);
+		last = key;
+		count++;
+	});
+	CHECK(count == 26);
+	std::size_t before = m.size();
+	!m;
+	CHECK(m.size() == before - 1); // only the entry operator() left at the default goes
+	CHECK((m >> 2) == 0);
+	CHECK((m >> 4) == 0);
+	CHECK((m >> 5) == 10);
+}
+
+// Writers, readers, a scanner and the compactor all run at once, the end state is what the writers last wrote.
+static void everything_at_once() {
+	extended::skiplist_map<int, int> m;
+	std::atomic<bool>                done{false};
+	std::atomic<int>                 wrong{0};
+	std::vector<std::thread>         threads;
+	for (int t = 0; t < 4; ++t) {
+		threads.emplace_back([&m, t] {
+			for (int round = 1; round <= 30; ++round) {
+				for (int key = t; key < 2000; key += 4) {
+					m << std::make_pair(key, (round % 3 == 0) ? 0 : round * 10000 + key);
+				}
+			}
+		});
+	}
+	threads.emplace_back([&] {
+		while (!done.load()) {
+			int last = -1;
+			m.for_each([&](int key, int value) {
+				if ((key <= last) || (value % 10000 != key)) {
+					wrong++;
+				}
+				last = key;
+			});
+		}
+	});
+	threads.emplace_back([&] {
+		while (!done.load()) {
+			!m;
+		}
+	});
+	for (int t = 0; t < 4; ++t) {
+		threads[t].join();
+	}
+	done = true;
+	threads[4].join();
+	threads[5].join();
+	CHECK(wrong.load() == 0);
+	!m;
+	CHECK(m.size() == 0); // round 30 erased every key
+}
+
+// Churn without operator! keeps the retired memory bounded, writers free it themselves.
+static void churn_stays_bounded() {
+	watched m;
+	for (int round = 0; round < 200; ++round) {
+		for (int key = 0; key < 50; ++key) {
+			m << std::make_pair(key, std::string(64, (char)('a' + round % 26)));
+		}
+	}
+	CHECK(m.waiting() < 1000);
+	CHECK((m >> 7) == std::string(64, (char)('a' + 199 % 26)));
+}
+
+int main() {
+	ordered_scans();
+	everything_at_once();
+	churn_stays_bounded();
+	return 0;
+}
@@ -0,0 +1,104 @@
+#include "extended.h"
+#include "check.h"
+
+#include <array>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+using block = std::array<uint64_t, 16>;
+
+static block fill(uint64_t value) {
+	block out;
+	out.fill(value);
+	return out;
+}
+
+static void reads_in_key_order() {
+	extended::slab_map<int, block> m(fill(0));
+	for (int i = 1; i <= 10; ++i) {
+		m << std::make_pair(i, fill(i));
+	}
+	CHECK(m.size() == 10);
+	CHECK(m.slots() == 10);
+	for (int i = 1; i <= 10; ++i) {
+		CHECK((m >> i) == fill(i));
+	}
+	CHECK((m >> 11) == fill(0));
+	
+	int next = 1;
+	m.for_each([&](int key, const block& value) {
+		CHECK(key == next);
+		CHECK(value == fill(key));
+		++next;
+	});
+	CHECK(next == 11);
+}
+
+static void erased_slots_are_reused() {
+	extended::slab_map<int, block> m(fill(0));
+	m << std::make_pair(1, fill(1));
+	m << std::make_pair(2, fill(2));
+	m << std::make_pair(1, fill(0));
+	CHECK(m.size() == 1);
+	CHECK((m >> 1) == fill(0));
+	
+	m << std::make_pair(3, fill(3));
+	CHECK(m.slots() == 2); // the slot of key 1 was given out again
+	CHECK((m >> 3) == fill(3));
+	
+	m(std::make_pair(4, fill(0)));
+	CHECK(m.size() == 2);
+}
+
+static void compaction_frees_slots() {
+	extended::slab_map<int, block> m(fill(0));
+	m << std::make_pair(1, fill(1));
+	m << std::make_pair(2, fill(2));
+	m(std::make_pair(1, fill(0)));
+	CHECK(m.size() == 2);
+	!m;
+	CHECK(m.size() == 1);
+	CHECK((m >> 2) == fill(2));
+	
+	m << std::make_pair(5, fill(5));
+	CHECK(m.slots() == 2);
+}
+
+// The map is not thread safe, but its const reads write nothing, so readers may share a lock while one writer holds it alone.
+static void const_reads_share_a_lock() {
+	extended::slab_map<int, block> m(fill(0));
+	std::shared_mutex              lock;
+	std::vector<std::thread>       readers;
+	for (int t = 0; t < 3; ++t) {
+		readers.emplace_back([&] {
+			for (int round = 0; round < 2000; ++round) {
+				std::shared_lock<std::shared_mutex> hold(lock);
+				for (int i = 0; i < 64; ++i) {
+					const block& value = m >> i;
+					CHECK((value == fill(0)) || (value[0] % 64 == (uint64_t)i)); // never a torn or foreign value
+				}
+				hold.unlock();
+				std::this_thread::yield();
+			}
+		});
+	}
+	for (int round = 1; round <= 200; ++round) {
+		for (int i = 0; i < 64; ++i) {
+			std::unique_lock<std::shared_mutex> hold(lock);
+			m << std::make_pair(i, ((round + i) % 5) ? fill(round * 64 + i) : fill(0));
+		}
+	}
+	for (auto& reader : readers) {
+		reader.join();
+	}
+	CHECK(m.slots() <= 64);
+}
+
+int main() {
+	reads_in_key_order();
+	erased_slots_are_reused();
+	compaction_frees_slots();
+	const_reads_share_a_lock();
+	return 0;
+}
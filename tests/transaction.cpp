@@ -0,0 +1,115 @@
+#include "extended.h"
+#include "check.h"
+
+#include <stdexcept>
+#include <string>
+
+/**
+ * \brief A value whose copies can be made to throw, to check that a failed write leaves the map as it was.
+ */
+struct fragile {
+	static int budget; ///< \c budget is how many more copies may be made, -1 for no limit.
+	int        value = 0;
+	
+	fragile() = default;
+	fragile(int v) : value(v) {}
+	fragile(const fragile& other) : value(other.value) {
+		if (budget == 0) {
+			throw std::runtime_error("copy");
+		}
+		if (budget > 0) {
+			budget--;
+		}
+	}
+	fragile& operator= (const fragile& other) {
+		if (budget == 0) {
+			throw std::runtime_error("copy");
+		}
+		if (budget > 0) {
+			budget--;
+		}
+		value = other.value;
+		return *this;
+	}
+	bool operator== (const fragile& other) const { return value == other.value; }
+	bool operator!= (const fragile& other) const { return value != other.value; }
+};
+
+int fragile::budget = -1;
+
+static void commit_and_rollback() {
+	extended::map<int, std::string> m;
+	m << std::make_pair(1, std::string("one"));
+	m << std::make_pair(2, std::string("two"));
+	{
+		auto tx = m.begin_transaction();
+		tx << std::make_pair(1, std::string("uno"));
+		tx << std::make_pair(2, std::string());
+		tx << std::make_pair(3, std::string("tres"));
+		CHECK((tx >> 1) == "uno");
+		CHECK((tx >> 2).empty());
+		CHECK((m >> 1) == "one"); // nothing is visible before commit
+		CHECK(tx.pending() == 3);
+		tx.commit();
+		CHECK(tx.pending() == 0);
+	}
+	CHECK(m.size() == 2);
+	CHECK((m >> 1) == "uno");
+	CHECK(m.count(2) == 0);
+	CHECK((m >> 3) == "tres");
+	{
+		auto tx = m.begin_transaction();
+		tx << std::make_pair(4, std::string("four"));
+		tx.rollback();
+		tx.commit();
+	}
+	{
+		auto tx = m.begin_transaction();
+		tx << std::make_pair(5, std::string("five"));
+	}
+	CHECK(m.size() == 2); // a rolled back or dropped transaction changes nothing
+}
+
+// commit makes no copies, so a value type whose copies fail still commits every update.
+static void commit_does_not_copy() {
+	extended::map<int, fragile> m;
+	for (int i = 1; i <= 100; ++i) {
+		m << std::make_pair(i, fragile(i));
+	}
+	auto tx = m.begin_transaction();
+	for (int i = 50; i <= 150; ++i) {
+		tx << std::make_pair(i, (i % 2) ? fragile(i * 10) : fragile(0));
+	}
+	fragile::budget = 0;
+	tx.commit();
+	fragile::budget = -1;
+	for (int i = 1; i < 50; ++i) {
+		CHECK((m >> i).value == i);
+	}
+	for (int i = 50; i <= 150; ++i) {
+		CHECK((m >> i).value == ((i % 2) ? i * 10 : 0));
+		CHECK((m.count(i) == 1) == (i % 2 == 1));
+	}
+}
+
+// The key filter still answers for keys added by a commit, including when the commit fills it.
+static void commit_updates_the_filter() {
+	extended::map<int, int> m;
+	m.use_filter();
+	auto tx = m.begin_transaction();
+	for (int i = 0; i < 10000; ++i) {
+		tx << std::make_pair(i, i + 1);
+	}
+	tx.commit();
+	for (int i = 0; i < 10000; ++i) {
+		CHECK((m >> i) == i + 1);
+	}
+	CHECK((m >> -1) == 0);
+}
+
+int main() {
+	commit_and_rollback();
+	commit_does_not_copy();
+	commit_updates_the_filter();
+	return 0;
+}